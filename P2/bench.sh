@@ -0,0 +1,69 @@
+#!/bin/bash
+# Compara configuraciones de server5 con la misma carga: NUM_CLIENTS clientes en paralelo
+# subiendo FILE a s01 durante el primer turno. Requiere server5 y client5 compilados
+# y que s01..s04 resuelvan a esta máquina.
+# Además del ritmo de subidas reporta MB/s, el CPU que gastó el servidor por GB recibido y las
+# métricas de la política de turnos que el servidor imprime al terminar.
+# Uso: ./bench.sh <NUM_CLIENTS> <FILE> [backend...]
+#   SERVER_ARGS="-p 0"   opciones extra para server5 (p. ej. "-a 4" para varios acceptors
+#                        o "-r copy" para comparar con el camino sin splice; "-w -s drr" para
+#                        comparar políticas de turnos)
+#   TARGETS="s01"        alias que reciben las subidas, repartidos en orden entre los clientes
+#   SLOW_CLIENTS=50      clientes que piden puerto dinámico y nunca se conectan a él
+
+NUM_CLIENTS=${1:-200}
+FILE=$(realpath "${2:-../saludo1.txt}")
+shift 2
+BACKENDS=${@:-epoll uring}
+SLOW_CLIENTS=${SLOW_CLIENTS:-0}
+TARGETS=(${TARGETS:-s01})
+BIN_DIR=$(cd "$(dirname "$0")" && pwd)
+FILE_SIZE=$(stat -c %s "$FILE")
+CLK_TCK=$(getconf CLK_TCK)
+
+for BACKEND in $BACKENDS; do
+    WORK_DIR=$(mktemp -d)
+    mkdir -p "$WORK_DIR"/s01 "$WORK_DIR"/s02 "$WORK_DIR"/s03 "$WORK_DIR"/s04
+    cp "$FILE" "$WORK_DIR"/
+
+    HOME=$WORK_DIR "$BIN_DIR"/server5 -b "$BACKEND" $SERVER_ARGS s01 s02 s03 s04 > "$WORK_DIR"/server.log 2>&1 &
+    SERVER_PID=$!
+    sleep 0.5
+
+    # Los clientes lentos leen su puerto dinámico y se quedan quietos
+    SLOW_PIDS=()
+    for ((i = 0; i < SLOW_CLIENTS; i++)); do
+        bash -c 'exec 3<>/dev/tcp/127.0.0.1/49200; read -t 2 -u 3 -N 32 greeting; sleep 60' 2>/dev/null &
+        SLOW_PIDS+=($!)
+    done
+    sleep 0.2
+
+    START=$(date +%s.%N)
+    (
+        cd "$WORK_DIR"
+        for ((i = 0; i < NUM_CLIENTS; i++)); do
+            "$BIN_DIR"/client5 "${TARGETS[i % ${#TARGETS[@]}]}" 49200 "$(basename "$FILE")" > /dev/null 2>&1 &
+        done
+        wait
+    )
+    END=$(date +%s.%N)
+
+    # utime + stime del servidor en ticks, campos 14 y 15 de /proc/<pid>/stat
+    CPU_TICKS=$(awk '{ print $14 + $15 }' /proc/$SERVER_PID/stat 2>/dev/null || echo 0)
+
+    OK=$(grep -c SUCCESS "$WORK_DIR"/clientLog.txt 2>/dev/null || echo 0)
+    awk -v b="$BACKEND $SERVER_ARGS" -v ok="$OK" -v n="$NUM_CLIENTS" -v t="$(awk "BEGIN { print $END - $START }")" \
+        -v size="$FILE_SIZE" -v cpu="$(awk "BEGIN { print $CPU_TICKS / $CLK_TCK }")" \
+        'BEGIN {
+            gb = ok * size / 1e9
+            printf "%s: %d/%d uploads in %.3f s (%.0f uploads/s, %.1f MB/s, server cpu %.2f s", b, ok, n, t, ok / t, gb * 1000 / t, cpu
+            if (gb > 0) printf ", %.2f s/GB", cpu / gb
+            printf ")\n"
+        }'
+
+    [ ${#SLOW_PIDS[@]} -gt 0 ] && kill "${SLOW_PIDS[@]}" 2>/dev/null
+    kill $SERVER_PID 2>/dev/null
+    wait 2>/dev/null
+    sed -n '/Scheduler metrics/,$p' "$WORK_DIR"/server.log
+    rm -rf "$WORK_DIR"
+done
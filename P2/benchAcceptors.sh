@@ -0,0 +1,30 @@
+#!/bin/bash
+# Mide cuántos saludos por segundo atiende server5 con 1, 2 y 4 acceptors (-a). Cada corrida
+# levanta el servidor y lanza handshakeBench, que hace saludos completos con contenido de 5 bytes.
+# Los acceptors solo escalan si hay núcleos libres para ellos, así que conviene comparar con
+# nproc en mente. Requiere server5 y handshakeBench compilados.
+# Uso: ./benchAcceptors.sh [THREADS] [HANDSHAKES] [backend]
+#   SERVER_ARGS="-w"     opciones de server5 que se repiten en cada corrida
+#   ACCEPTORS="1 2 4"    valores de -a a comparar
+
+THREADS=${1:-16}
+HANDSHAKES=${2:-20000}
+BACKEND=${3:-epoll}
+BASE_ARGS=${SERVER_ARGS--w}
+BIN_DIR=$(cd "$(dirname "$0")" && pwd)
+
+echo "[*] $(nproc) CPUs, backend $BACKEND"
+for A in ${ACCEPTORS:-1 2 4}; do
+    WORK_DIR=$(mktemp -d)
+    mkdir -p "$WORK_DIR"/s01 "$WORK_DIR"/s02 "$WORK_DIR"/s03 "$WORK_DIR"/s04
+    HOME=$WORK_DIR "$BIN_DIR"/server5 -b "$BACKEND" -a "$A" $BASE_ARGS s01 s02 s03 s04 > "$WORK_DIR"/server.log 2>&1 &
+    SERVER_PID=$!
+    sleep 0.5
+
+    echo -n "-a $A: "
+    "$BIN_DIR"/handshakeBench "$THREADS" "$HANDSHAKES" s01
+
+    kill $SERVER_PID 2>/dev/null
+    wait 2>/dev/null
+    rm -rf "$WORK_DIR"
+done
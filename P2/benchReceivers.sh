@@ -0,0 +1,19 @@
+#!/bin/bash
+# Mide el throughput agregado de server5 cuando 1, 2, 3 y 4 servidores pueden recibir a la vez
+# (-k). Usa bench.sh con los clientes repartidos entre s01..s04 para que todos los servidores
+# tengan trabajo; con -k 1 se comporta como antes, un solo servidor recibe a la vez.
+# Uso: ./benchReceivers.sh <NUM_CLIENTS> <FILE> [backend]
+#   SERVER_ARGS="-w"     opciones de server5 que se repiten en cada corrida (p. ej. "-q 200"
+#                        para comparar con turnos estrictos)
+#   RECEIVERS="1 2 3 4"  valores de -k a comparar
+
+NUM_CLIENTS=${1:-200}
+FILE=${2:-../saludo1.txt}
+BACKEND=${3:-epoll}
+BASE_ARGS=${SERVER_ARGS--w}
+BIN_DIR=$(cd "$(dirname "$0")" && pwd)
+
+for K in ${RECEIVERS:-1 2 3 4}; do
+    SERVER_ARGS="$BASE_ARGS -k $K" TARGETS="s01 s02 s03 s04" "$BIN_DIR"/bench.sh "$NUM_CLIENTS" "$FILE" "$BACKEND" |
+        grep uploads
+done
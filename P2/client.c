@@ -5,26 +5,64 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include "protocol.h"
+#include "resolver.h"
+#include "clientLog.h"
 
 #define BUFFER_SIZE 1024
 char *servers[] = {"s01", "s02", "s03", "s04"};
 
 //clientB.c
 
+// Datos que necesita el hilo que sube el archivo a un servidor
+typedef struct {
+    const char *server;
+    int port;
+    const char *filename;
+    FILE *fp;
+} upload_t;
+
+/*
+    Función que manda el archivo por la conexión ya saludada y espera la respuesta. Regresa 0 si
+    terminó, -1 si hubo error o los milisegundos que sugiere esperar el servidor si respondió BUSY
+*/
+int sendUpload(int sock, bool framed, void *arg) {
+    upload_t *upload = (upload_t *)arg;
+    char response[BUFFER_SIZE];
+    int result = protocolSendWait(sock, upload->fp, framed, upload->server, upload->filename, 0,
+                                  response, sizeof(response));
+    if (result == 0) {
+        printf("SERVER RESPONSE from %s: %s\n", upload->server, response);
+        saveLog(protocolOutcome(response, strlen(response)), upload->filename, upload->server);
+    }
+    return result;
+}
+
 /*
-    Función para guardar fecha, hora, estado, nombre de archivo y servidor
+    Función que sube el archivo a un servidor: resuelve su alias y hace los intentos. Mientras el
+    servidor responda BUSY esperamos lo que sugiere, con variación al azar, y reintentamos. Cada
+    servidor tiene su propio hilo, así que un servidor lento ya no retrasa a los demás
 */
-void saveLog(const char *status, const char *filename, const char *server) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", t);
-    
-    FILE *log_file = fopen("clientLog.txt", "a");
-    if (log_file) {
-        fprintf(log_file, "%s | %s | %s | %s\n", timestamp, status, filename, server);
-        fclose(log_file);
+void* uploadFile(void* arg) {
+    upload_t *upload = (upload_t *)arg;
+
+    //Obtenemos la dirección ip atraves del alias, normalmente desde la caché
+    struct in_addr server_addr;
+    if (resolveHost(upload->server, &server_addr) < 0) {
+        perror("Error resolving hostname");
+        saveLog("ERROR", upload->filename, upload->server);
+        return NULL;
+    }
+
+    int result = protocolUpload(server_addr, upload->port, upload->server, sendUpload, upload);
+    if (result > 0) {
+        saveLog("BUSY", upload->filename, upload->server);
+    } else if (result < 0) {
+        saveLog("ERROR", upload->filename, upload->server);
     }
+    return NULL;
 }
 
 /*
@@ -32,19 +70,29 @@ void saveLog(const char *status, const char *filename, const char *server) {
     a los servidores restantes
 */
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        printf("USE: %s <SERVER> <PORT> <FILE>\n", argv[0]);
+    // -s recorre los servidores uno por uno; sin -s todos se atienden al mismo tiempo
+    bool sequential = false;
+    int opt_char;
+    while ((opt_char = getopt(argc, argv, "s")) != -1) {
+        switch (opt_char) {
+            case 's':
+                sequential = true;
+                break;
+            default:
+                printf("USE: %s [-s] <SERVER> <PORT> <FILE>\n", argv[0]);
+                exit(1);
+        }
+    }
+
+    if (argc - optind != 3) {
+        printf("USE: %s [-s] <SERVER> <PORT> <FILE>\n", argv[0]);
         printf("Example: %s s01 49200 file1.txt\n", argv[0]);
         exit(1);
     }
 
-    int client_sock;
-    char *server_ip = argv[1];
-    int port = atoi(argv[2]);
-    char *filename = argv[3];
-    struct sockaddr_in serv_addr;
-    int dynamic_port;
-    struct addrinfo name, *res;
+    char *server_ip = argv[optind];
+    int port = atoi(argv[optind + 1]);
+    char *filename = argv[optind + 2];
     // Leer archivo
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -53,91 +101,35 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    char file_content[BUFFER_SIZE] = {0};
-    size_t bytes_read = fread(file_content, 1, sizeof(file_content) - 1, fp);
-    file_content[bytes_read] = '\0';
-    fclose(fp);
+    // Si el servidor corta el envío con BUSY, send falla en lugar de terminar el proceso
+    signal(SIGPIPE, SIG_IGN);
 
+    // Cada servidor recibe el archivo en su propio hilo, así el tiempo total es el del servidor más
+    // lento y no la suma de todos. Los hilos comparten fp porque sendfile lleva su propio offset
+    upload_t uploads[4];
+    pthread_t threads[4];
+    int num_uploads = 0;
+    int num_threads = 0;
     for (int i = 0; i < 4; i++) {
         if (strcmp(server_ip, servers[i]) == 0){
             continue;
         }
-        //Obtenemos la dirección ip atraves del alias
-        memset(&name, 0, sizeof name);
-        name.ai_family = AF_INET;
-        name.ai_socktype = SOCK_STREAM;
-        
-        if (getaddrinfo(servers[i], NULL, &name, &res) != 0) {
-            perror("Error resolving hostname");
-            saveLog("ERROR", filename, servers[i]);
-            exit(1);
-        }
-
-        //Creamos el socket del cliente para la comunicación
-        client_sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (client_sock < 0) {
-            perror("Socket creation failed");
-            freeaddrinfo(res);
-            exit(1);
-        }
-        
-        // Configuramos la dirección del cliente
-        serv_addr.sin_family = AF_INET;
-        serv_addr.sin_port = htons(port);
-        struct sockaddr_in *ipv4 = (struct sockaddr_in *)res->ai_addr;
-        serv_addr.sin_addr = ipv4->sin_addr;
-        
-        freeaddrinfo(res);  
-
-        //Nos conectamos al servidor
-        if (connect(client_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-            perror("Connection failed");
-            close(client_sock);
-            exit(1);
-        }
-
-        // Recibimos el puerto dinámico
-        char port_response[64] = {0};
-        int bytes_received = recv(client_sock, port_response, sizeof(port_response) - 1, 0);
-        if (bytes_received <= 0) {
-            perror("Error receiving port");
-            close(client_sock);
-            exit(1);
-        }
-        port_response[bytes_received] = '\0';
-        close(client_sock);
-
-        // Nos conectamos al puerto dinámico recibido
-        if (sscanf(port_response, "DYNAMIC_PORT|%d", &dynamic_port) == 1) {
-            int dynamic_sock = socket(AF_INET, SOCK_STREAM, 0);
-            serv_addr.sin_port = htons(dynamic_port);
-            
-            if (connect(dynamic_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-                perror("Connection to dynamic port failed");
-                exit(1);
+        uploads[num_uploads] = (upload_t){servers[i], port, filename, fp};
+        upload_t *upload = &uploads[num_uploads++];
+        if (!sequential) {
+            int error = pthread_create(&threads[num_threads], NULL, uploadFile, upload);
+            if (error == 0) {
+                num_threads++;
+                continue;
             }
-
-            char buffer[BUFFER_SIZE*2];
-            snprintf(buffer, sizeof(buffer), "%s|%s|%s", servers[i], filename, file_content);
-
-            if (send(dynamic_sock, buffer, strlen(buffer), 0) < 0) {
-                perror("Send failed");
-                close(dynamic_sock);
-                exit(1);
-            }
-
-            char response[BUFFER_SIZE] = {0};
-            int bytes = recv(dynamic_sock, response, sizeof(response) - 1, 0);
-            if (bytes > 0) {
-                response[bytes] = '\0';
-                printf("SERVER RESPONSE from %s: %s\n", servers[i], response);
-                saveLog("SUCCESS", filename, servers[i]);
-            } else {
-                printf("No response from server\n");
-            }
-            
-            close(dynamic_sock);
+            // Si no se pudo crear el hilo lo subimos aquí mismo, como con -s
+            printf("Error creating upload thread for %s: %s\n", upload->server, strerror(error));
         }
+        uploadFile(upload);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
     }
+    fclose(fp);
     return 0;
 }
@@ -5,25 +5,36 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <time.h>
+#include <signal.h>
+#include "protocol.h"
+#include "resolver.h"
+#include "clientLog.h"
 
 #define BUFFER_SIZE 1024
 
 //client.c
 
+// Datos que necesita la subida una vez hecho el saludo
+typedef struct {
+    const char *server;
+    const char *filename;
+    FILE *fp;
+} upload_t;
+
 /*
-    Función para guardar fecha, hora, estado, nombre de archivo y servidor
+    Función que manda el archivo por la conexión ya saludada y espera la respuesta. Regresa 0 si
+    terminó, -1 si hubo error o los milisegundos que sugiere esperar el servidor si respondió BUSY
 */
-void saveLog(const char *status, const char *filename, const char *server) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", t);
-    
-    FILE *log_file = fopen("clientLog.txt", "a");
-    if (log_file) {
-        fprintf(log_file, "%s | %s | %s | %s\n", timestamp, status, filename, server);
-        fclose(log_file);
+int sendUpload(int sock, bool framed, void *arg) {
+    upload_t *upload = (upload_t *)arg;
+    char response[BUFFER_SIZE];
+    int result = protocolSendWait(sock, upload->fp, framed, upload->server, upload->filename, 0,
+                                  response, sizeof(response));
+    if (result == 0) {
+        printf("SERVER RESPONSE: %s\n", response);
+        saveLog(protocolOutcome(response, strlen(response)), upload->filename, upload->server);
     }
+    return result;
 }
 
 /*
@@ -36,14 +47,10 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    int client_sock;
     char *server_ip = argv[1];
     int port = atoi(argv[2]);
     int num_times = atoi(argv[3]);
     char *filename = argv[4];
-    struct sockaddr_in serv_addr;
-    int dynamic_port;
-    struct addrinfo name, *res;
     // Leer archivo
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -51,87 +58,28 @@ int main(int argc, char *argv[]) {
         saveLog("ERROR", filename, "File not found");
         exit(1);
     }
+    // Si el servidor corta el envío con BUSY, send falla en lugar de terminar el proceso
+    signal(SIGPIPE, SIG_IGN);
 
-    char file_content[BUFFER_SIZE] = {0};
-    size_t bytes_read = fread(file_content, 1, sizeof(file_content) - 1, fp);
-    file_content[bytes_read] = '\0';
-    fclose(fp);
     for (int i = 0; i < num_times; i++) {
-        //Obtenemos la dirección ip atraves del alias
-        memset(&name, 0, sizeof name);
-        name.ai_family = AF_INET;
-        name.ai_socktype = SOCK_STREAM;
-        
-        if (getaddrinfo(server_ip, NULL, &name, &res) != 0) {
+        //Obtenemos la dirección ip atraves del alias, normalmente desde la caché
+        struct in_addr server_addr;
+        if (resolveHost(server_ip, &server_addr) < 0) {
             perror("Error resolving hostname");
             saveLog("ERROR", filename, "Host resolution failed");
             exit(1);
         }
 
-        //Creamos el socket del cliente para la comunicación
-        client_sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (client_sock < 0) {
-            perror("Socket creation failed");
-            exit(1);
+        // Mientras el servidor responda BUSY esperamos lo que sugiere, con variación al azar, y reintentamos
+        upload_t upload = {server_ip, filename, fp};
+        int result = protocolUpload(server_addr, port, server_ip, sendUpload, &upload);
+        if (result > 0) {
+            saveLog("BUSY", filename, server_ip);
         }
-        
-        // Configuramos la dirección del cliente
-        serv_addr.sin_family = AF_INET;
-        serv_addr.sin_port = htons(port);
-        struct sockaddr_in *ipv4 = (struct sockaddr_in *)res->ai_addr;
-        serv_addr.sin_addr = ipv4->sin_addr;
-        
-        freeaddrinfo(res);  
-
-        //Nos conectamos al servidor
-        if (connect(client_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-            perror("Connection failed");
-            close(client_sock);
-            exit(1);
-        }
-
-        // Recibimos el puerto dinámico
-        char port_response[64] = {0};
-        int bytes_received = recv(client_sock, port_response, sizeof(port_response) - 1, 0);
-        if (bytes_received <= 0) {
-            perror("Error receiving port");
-            close(client_sock);
+        if (result != 0) {
             exit(1);
         }
-        port_response[bytes_received] = '\0';
-        close(client_sock);
-
-        // Nos conectamos al puerto dinámico recibido
-        if (sscanf(port_response, "DYNAMIC_PORT|%d", &dynamic_port) == 1) {
-            int dynamic_sock = socket(AF_INET, SOCK_STREAM, 0);
-            serv_addr.sin_port = htons(dynamic_port);
-            
-            if (connect(dynamic_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-                perror("Connection to dynamic port failed");
-                exit(1);
-            }
-
-            char buffer[BUFFER_SIZE*2];
-            snprintf(buffer, sizeof(buffer), "%s|%s|%s", server_ip, filename, file_content);
-
-            if (send(dynamic_sock, buffer, strlen(buffer), 0) < 0) {
-                perror("Send failed");
-                close(dynamic_sock);
-                exit(1);
-            }
-
-            char response[BUFFER_SIZE] = {0};
-            int bytes = recv(dynamic_sock, response, sizeof(response) - 1, 0);
-            if (bytes > 0) {
-                response[bytes] = '\0';
-                printf("SERVER RESPONSE: %s\n", response);
-                saveLog("SUCCESS", filename, server_ip);
-            } else {
-                printf("No response from server\n");
-            }
-            
-            close(dynamic_sock);
-        }
     }
+    fclose(fp);
     return 0;
 }
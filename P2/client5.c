@@ -5,140 +5,181 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <time.h>
+#include <signal.h>
+#include "protocol.h"
+#include "resolver.h"
+#include "clientLog.h"
 
 #define BUFFER_SIZE 1024
 
 //client.c
 
 /*
-    Función para guardar fecha, hora, estado, nombre de archivo y servidor
+    Función que manda los archivos en una sola sesión sin esperar la confirmación de cada uno. Hasta
+    window archivos pueden ir en camino; cada confirmación trae el número de archivo, así sabemos a
+    cuál corresponde aunque lleguen varias juntas. Regresa 0, -1 si hubo error o los milisegundos que
+    sugiere esperar el servidor si respondió BUSY; eso solo pasa con el primer archivo, antes de guardar nada
 */
-void saveLog(const char *status, const char *filename, const char *server) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", t);
-    
-    FILE *log_file = fopen("clientLog.txt", "a");
-    if (log_file) {
-        fprintf(log_file, "%s | %s | %s | %s\n", timestamp, status, filename, server);
-        fclose(log_file);
+int sendSession(int sock, const char *server_ip, char **filenames, int num_files, int window) {
+    char acks[BUFFER_SIZE];
+    size_t ack_len = 0;
+    int next = 0;
+    int acked = 0;
+
+    while (acked < num_files) {
+        // Mandamos archivos mientras haya lugar en la ventana
+        while (next < num_files && next - acked < window) {
+            printf("Sending file: %s\n", filenames[next]);
+            FILE *fp = fopen(filenames[next], "r");
+            if (!fp) {
+                perror("Error opening file");
+                saveLog("ERROR", filenames[next], "File not found");
+                return -1;
+            }
+            int sent = protocolSendFile(sock, fp, true, server_ip, filenames[next], next, FRAME_FLAG_ACK);
+            fclose(fp);
+            if (sent < 0) {
+                int busy_ms = busyPending(sock);
+                if (busy_ms < 0) {
+                    perror("Send failed");
+                }
+                return busy_ms;
+            }
+            next++;
+        }
+
+        int bytes = recv(sock, acks + ack_len, sizeof(acks) - ack_len, 0);
+        if (bytes <= 0) {
+            printf("No response from server\n");
+            return -1;
+        }
+        ack_len += bytes;
+
+        // Atendemos todas las confirmaciones completas que llegaron
+        size_t offset = 0;
+        while (offset < ack_len) {
+            uint32_t seq;
+            const char *message;
+            size_t message_len;
+            int used = ackParse(acks + offset, ack_len - offset, &seq, &message, &message_len);
+            if (used == 0) {
+                break;
+            }
+            if (used < 0 || seq >= (uint32_t)next) {
+                printf("Invalid response from server\n");
+                return -1;
+            }
+            printf("SERVER RESPONSE [%u]: %.*s\n", seq, (int)message_len, message);
+            int busy_ms = busyParse(message, message_len);
+            if (busy_ms > 0) {
+                return busy_ms;
+            }
+            saveLog(protocolOutcome(message, message_len), filenames[seq], server_ip);
+            acked++;
+            offset += used;
+        }
+        if (offset == 0 && ack_len == sizeof(acks)) {
+            printf("Invalid response from server\n");
+            return -1;
+        }
+        memmove(acks, acks + offset, ack_len - offset);
+        ack_len -= offset;
     }
+    return 0;
 }
 
+// Datos que necesita la subida una vez hecho el saludo
+typedef struct {
+    const char *server;
+    char **filenames;
+    int num_files;
+    int window;
+} upload_t;
+
 /*
-    Función principal para conectar al servidor, recibir un puerto dinámico, conectarse a él y enviar o recibir datos
+    Función que manda los archivos por la conexión ya saludada: en una sesión, o uno por uno si el
+    servidor no entiende frames. Regresa 0 si terminó, -1 si hubo error o los milisegundos que
+    sugiere esperar el servidor si respondió BUSY
 */
-int main(int argc, char *argv[]) {
-    if (argc < 4) {
-        printf("USE: %s <SERVER> <PORT> <FILE1> <FILE2> <FILE3> ...\n", argv[0]);
-        printf("Example: %s s01 49200 file1.txt file2.txt...\n", argv[0]);
-        exit(1);
+int sendFiles(int sock, bool framed, void *arg) {
+    upload_t *upload = (upload_t *)arg;
+    // Con frames la subida es una sesión con confirmaciones numeradas
+    if (framed) {
+        return sendSession(sock, upload->server, upload->filenames, upload->num_files, upload->window);
     }
 
-    int client_sock;
-    char *server_ip = argv[1];
-    int port = atoi(argv[2]);
-    char *filenames[argc - 3];
-    for (int i = 3; i < argc; i++) {
-        filenames[i - 3] = argv[i];
-    }
-    struct sockaddr_in serv_addr;
-    int dynamic_port;
-    struct addrinfo name, *res;
-    
-    //Obtenemos la dirección ip atraves del alias
-    memset(&name, 0, sizeof name);
-    name.ai_family = AF_INET;
-    name.ai_socktype = SOCK_STREAM;
-    
-    if (getaddrinfo(server_ip, NULL, &name, &res) != 0) {
-        perror("Error resolving hostname");
-        saveLog("ERROR", filenames[0], "Host resolution failed");
-        exit(1);
+    for (int i = 0; i < upload->num_files; i++) {
+        char *filename = upload->filenames[i];
+        printf("Sending file: %s\n", filename);
+        FILE *fp = fopen(filename, "r");
+        if (!fp) {
+            perror("Error opening file");
+            saveLog("ERROR", filename, "File not found");
+            return -1;
+        }
+
+        char response[BUFFER_SIZE];
+        int result = protocolSendWait(sock, fp, framed, upload->server, filename, i, response, sizeof(response));
+        fclose(fp);
+        if (result < 0) {
+            saveLog("ERROR", filename, upload->server);
+        }
+        if (result != 0) {
+            return result;
+        }
+        printf("SERVER RESPONSE: %s\n", response);
+        saveLog(protocolOutcome(response, strlen(response)), filename, upload->server);
     }
+    return 0;
+}
 
-    //Creamos el socket del cliente para la comunicación
-    client_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_sock < 0) {
-        perror("Socket creation failed");
-        exit(1);
+/*
+    Función principal para conectar al servidor, recibir un puerto dinámico, conectarse a él y enviar o recibir datos
+*/
+int main(int argc, char *argv[]) {
+    // -w indica cuántos archivos pueden ir en camino sin confirmación
+    int window = 1;
+    int opt_char;
+    while ((opt_char = getopt(argc, argv, "w:")) != -1) {
+        switch (opt_char) {
+            case 'w':
+                window = atoi(optarg);
+                if (window < 1) {
+                    window = 1;
+                }
+                break;
+            default:
+                printf("USE: %s [-w WINDOW] <SERVER> <PORT> <FILE1> <FILE2> <FILE3> ...\n", argv[0]);
+                exit(1);
+        }
     }
-    
-    // Configuramos la dirección del cliente
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    struct sockaddr_in *ipv4 = (struct sockaddr_in *)res->ai_addr;
-    serv_addr.sin_addr = ipv4->sin_addr;
-    
-    freeaddrinfo(res);  
 
-    //Nos conectamos al servidor
-    if (connect(client_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        perror("Connection failed");
-        close(client_sock);
+    if (argc - optind < 3) {
+        printf("USE: %s [-w WINDOW] <SERVER> <PORT> <FILE1> <FILE2> <FILE3> ...\n", argv[0]);
+        printf("Example: %s -w 16 s01 49200 file1.txt file2.txt...\n", argv[0]);
         exit(1);
     }
 
-    // Recibimos el puerto dinámico
-    char port_response[64] = {0};
-    int bytes_received = recv(client_sock, port_response, sizeof(port_response) - 1, 0);
-    if (bytes_received <= 0) {
-        perror("Error receiving port");
-        close(client_sock);
+    char *server_ip = argv[optind];
+    int port = atoi(argv[optind + 1]);
+    int num_files = argc - optind - 2;
+    char **filenames = &argv[optind + 2];
+    // Si el servidor corta el envío con BUSY, send falla en lugar de terminar el proceso
+    signal(SIGPIPE, SIG_IGN);
+    
+    //Obtenemos la dirección ip atraves del alias, normalmente desde la caché
+    struct in_addr server_addr;
+    if (resolveHost(server_ip, &server_addr) < 0) {
+        perror("Error resolving hostname");
+        saveLog("ERROR", filenames[0], "Host resolution failed");
         exit(1);
     }
-    port_response[bytes_received] = '\0';
-    close(client_sock);
-
-    // Nos conectamos al puerto dinámico recibido
-    if (sscanf(port_response, "DYNAMIC_PORT|%d", &dynamic_port) == 1) {
-        int dynamic_sock = socket(AF_INET, SOCK_STREAM, 0);
-        serv_addr.sin_port = htons(dynamic_port);
-        
-        if (connect(dynamic_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-            perror("Connection to dynamic port failed");
-            exit(1);
-        }
 
-        for(int i = 0; i < argc - 3; i++) {
-            // Enviamos el archivo
-            char *filename = filenames[i];
-            printf("Sending file: %s\n", filename);
-            // Leer archivo
-            FILE *fp = fopen(filename, "r");
-            if (!fp) {
-                perror("Error opening file");
-                saveLog("ERROR", filename, "File not found");
-                exit(1);
-            }
-
-            char file_content[BUFFER_SIZE] = {0};
-            size_t bytes_read = fread(file_content, 1, sizeof(file_content) - 1, fp);
-            file_content[bytes_read] = '\0';
-            fclose(fp);
-
-            char buffer[BUFFER_SIZE*2];
-            snprintf(buffer, sizeof(buffer), "%s|%s|%s", server_ip, filename, file_content);
-
-            if (send(dynamic_sock, buffer, strlen(buffer), 0) < 0) {
-                perror("Send failed");
-                close(dynamic_sock);
-                exit(1);
-            }
-
-            char response[BUFFER_SIZE] = {0};
-            int bytes = recv(dynamic_sock, response, sizeof(response) - 1, 0);
-            if (bytes > 0) {
-                response[bytes] = '\0';
-                printf("SERVER RESPONSE: %s\n", response);
-                saveLog("SUCCESS", filename, server_ip);
-            } else {
-                printf("No response from server\n");
-            }
-        }
-        close(dynamic_sock);
+    // Mientras el servidor responda BUSY esperamos lo que sugiere, con variación al azar, y reintentamos
+    upload_t upload = {server_ip, filenames, num_files, window};
+    int result = protocolUpload(server_addr, port, server_ip, sendFiles, &upload);
+    if (result > 0) {
+        saveLog("BUSY", filenames[0], server_ip);
     }
-    
-    return 0;
+    return result == 0 ? 0 : 1;
 }
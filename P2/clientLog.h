@@ -0,0 +1,196 @@
+#ifndef CLIENT_LOG_H
+#define CLIENT_LOG_H
+
+/*
+    Bitácora de los clientes. Antes cada evento abría clientLog.txt, formateaba la hora con
+    localtime y strftime, escribía una línea y cerraba el archivo. Ahora el archivo se abre una
+    sola vez, las líneas se juntan en un buffer y la hora formateada se reutiliza mientras no
+    cambie el segundo. Un hilo vacía el buffer cada LOG_FLUSH_SECONDS y al salir del proceso se
+    escribe lo pendiente, así que el archivo queda igual que antes.
+
+    Con CLIENT_LOG_FORMAT=binary los eventos se guardan en clientLog.bin como registros binarios
+    en orden de red, sin formatear la hora. logConvert los pasa al formato de texto:
+        magic        u8    LOG_RECORD_MAGIC
+        status       u8    LOG_STATUS_*; con LOG_STATUS_OTHER el texto va después del encabezado
+        status_len   u8
+        server_len   u8
+        filename_len u16
+        time         u64   segundos desde epoch
+    seguido del estado (solo con LOG_STATUS_OTHER), el servidor y el nombre del archivo.
+*/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TEXT_FILE "clientLog.txt"
+#define LOG_BINARY_FILE "clientLog.bin"
+#define LOG_BUFFER_SIZE 16384
+#define LOG_FLUSH_SECONDS 1
+#define LOG_RECORD_MAGIC 0xC1
+#define LOG_RECORD_HEAD 14
+#define LOG_MAX_FIELD 255
+
+enum {
+    LOG_STATUS_SUCCESS = 0,
+    LOG_STATUS_ERROR = 1,
+    LOG_STATUS_REJECTED = 2,
+    LOG_STATUS_OTHER = 255
+};
+
+typedef struct {
+    int fd;
+    bool binary;
+    bool started;
+    char buffer[LOG_BUFFER_SIZE];
+    size_t used;
+    time_t cached_second;
+    char timestamp[64];
+    pthread_mutex_t mutex;
+} client_log_t;
+
+static client_log_t client_log = {.fd = -1, .mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static inline const char *logStatusName(uint8_t status) {
+    switch (status) {
+        case LOG_STATUS_SUCCESS:
+            return "SUCCESS";
+        case LOG_STATUS_ERROR:
+            return "ERROR";
+        case LOG_STATUS_REJECTED:
+            return "REJECTED";
+        default:
+            return NULL;
+    }
+}
+
+static inline uint8_t logStatusCode(const char *status) {
+    for (uint8_t code = LOG_STATUS_SUCCESS; code <= LOG_STATUS_REJECTED; code++) {
+        if (strcmp(logStatusName(code), status) == 0) {
+            return code;
+        }
+    }
+    return LOG_STATUS_OTHER;
+}
+
+/*
+    Función que escribe el buffer en el archivo. Con O_APPEND cada write queda completo al final
+    aunque otros clientes escriban en el mismo archivo. Se llama con el mutex tomado
+*/
+static inline void logFlushLocked(void) {
+    size_t offset = 0;
+    while (offset < client_log.used && client_log.fd >= 0) {
+        ssize_t written = write(client_log.fd, client_log.buffer + offset, client_log.used - offset);
+        if (written <= 0) {
+            break;
+        }
+        offset += written;
+    }
+    client_log.used = 0;
+}
+
+static inline void logFlush(void) {
+    pthread_mutex_lock(&client_log.mutex);
+    logFlushLocked();
+    pthread_mutex_unlock(&client_log.mutex);
+}
+
+/*
+    Hilo que vacía el buffer periódicamente para que los clientes largos (client4, client5) no
+    retengan eventos hasta salir
+*/
+static inline void *logFlushThread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(LOG_FLUSH_SECONDS);
+        logFlush();
+    }
+    return NULL;
+}
+
+/*
+    Función que abre el archivo la primera vez que se registra algo. Se llama con el mutex tomado
+*/
+static inline void logStart(void) {
+    client_log.started = true;
+    const char *format = getenv("CLIENT_LOG_FORMAT");
+    client_log.binary = format && strcmp(format, "binary") == 0;
+    client_log.fd = open(client_log.binary ? LOG_BINARY_FILE : LOG_TEXT_FILE,
+                         O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    atexit(logFlush);
+
+    pthread_t flush_thread;
+    if (pthread_create(&flush_thread, NULL, logFlushThread, NULL) == 0) {
+        pthread_detach(flush_thread);
+    }
+}
+
+/*
+    Función que arma el registro binario del evento en el buffer. Regresa su longitud
+*/
+static inline size_t logEncodeRecord(char *out, time_t now, const char *status, const char *filename, const char *server) {
+    uint8_t code = logStatusCode(status);
+    size_t status_len = code == LOG_STATUS_OTHER ? strnlen(status, LOG_MAX_FIELD) : 0;
+    size_t server_len = strnlen(server, LOG_MAX_FIELD);
+    size_t filename_len = strnlen(filename, LOG_MAX_FIELD);
+    unsigned char *p = (unsigned char *)out;
+    uint64_t seconds = (uint64_t)now;
+
+    p[0] = LOG_RECORD_MAGIC;
+    p[1] = code;
+    p[2] = status_len;
+    p[3] = server_len;
+    p[4] = filename_len >> 8;
+    p[5] = filename_len & 0xFF;
+    for (int i = 0; i < 8; i++) {
+        p[6 + i] = seconds >> (56 - 8 * i);
+    }
+    memcpy(out + LOG_RECORD_HEAD, status, status_len);
+    memcpy(out + LOG_RECORD_HEAD + status_len, server, server_len);
+    memcpy(out + LOG_RECORD_HEAD + status_len + server_len, filename, filename_len);
+    return LOG_RECORD_HEAD + status_len + server_len + filename_len;
+}
+
+/*
+    Función para guardar fecha, hora, estado, nombre de archivo y servidor
+*/
+static inline void saveLog(const char *status, const char *filename, const char *server) {
+    time_t now = time(NULL);
+    // El registro más grande cabe de sobra en este margen del buffer
+    size_t max_record = LOG_RECORD_HEAD + 3 * LOG_MAX_FIELD + 64;
+
+    pthread_mutex_lock(&client_log.mutex);
+    if (!client_log.started) {
+        logStart();
+    }
+    if (client_log.used + max_record > sizeof(client_log.buffer)) {
+        logFlushLocked();
+    }
+
+    char *out = client_log.buffer + client_log.used;
+    if (client_log.binary) {
+        client_log.used += logEncodeRecord(out, now, status, filename, server);
+    } else {
+        // Solo se formatea la hora cuando cambia el segundo
+        if (now != client_log.cached_second) {
+            struct tm t;
+            localtime_r(&now, &t);
+            strftime(client_log.timestamp, sizeof(client_log.timestamp), "%Y-%m-%d %H:%M:%S", &t);
+            client_log.cached_second = now;
+        }
+        int written = snprintf(out, max_record, "%s | %.63s | %.255s | %.255s\n",
+                               client_log.timestamp, status, filename, server);
+        if (written > 0) {
+            client_log.used += (size_t)written < max_record ? (size_t)written : max_record - 1;
+        }
+    }
+    pthread_mutex_unlock(&client_log.mutex);
+}
+
+#endif
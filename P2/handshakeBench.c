@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include "protocol.h"
+
+//handshakeBench.c
+
+/*
+    Mide cuántos saludos por segundo atiende server5. Varios hilos hacen a la vez el ciclo completo
+    de un cliente: conectar al puerto base, leer el puerto dinámico, mandar un frame con un contenido
+    de 5 bytes (por la misma conexión si el servidor ofrece INLINE) y esperar la respuesta. El
+    contenido es mínimo para que lo que se mida sea el saludo y no el guardado del archivo.
+    Sirve para comparar acceptors (-a) y backends; conviene correr el servidor con -w para que
+    la espera de turno no cuente.
+    Compilar: gcc -Wall -O2 -pthread -o handshakeBench handshakeBench.c
+*/
+
+typedef struct {
+    const char* alias;
+    int port;
+    long per_thread;
+} bench_t;
+
+atomic_long succeeded;
+atomic_long failed;
+atomic_long busy;
+
+double elapsedSeconds(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/*
+    Función que hace un saludo completo. Regresa 0 si el archivo se recibió, 1 si el servidor
+    respondió BUSY y -1 si hubo error
+*/
+int handshakeOnce(const bench_t* bench, const char* filename) {
+    struct in_addr loopback = {.s_addr = htonl(INADDR_LOOPBACK)};
+    int sock;
+    bool framed;
+    int result = protocolGreet(loopback, bench->port, &sock, &framed);
+    if (result != 0) {
+        return result > 0 ? 1 : -1;
+    }
+
+    char frame[FRAME_MAX_HEAD + 8];
+    size_t frame_len = protocolEncode(frame, sizeof(frame), framed, bench->alias, filename, "hola\n", 5, 0);
+    char reply[128];
+    ssize_t bytes;
+    if (frame_len == 0 || protocolSendAll(sock, frame, frame_len, 0) < 0 ||
+        (bytes = recv(sock, reply, sizeof(reply) - 1, 0)) <= 0) {
+        close(sock);
+        return -1;
+    }
+    close(sock);
+    return busyParse(reply, bytes) > 0 ? 1 : 0;
+}
+
+void* clientThread(void* arg) {
+    bench_t* bench = (bench_t*)arg;
+    char filename[64];
+    snprintf(filename, sizeof(filename), "hs%lu.txt", (unsigned long)pthread_self() % 100000);
+    for (long i = 0; i < bench->per_thread; i++) {
+        int result = handshakeOnce(bench, filename);
+        if (result == 0) {
+            atomic_fetch_add(&succeeded, 1);
+        } else if (result > 0) {
+            atomic_fetch_add(&busy, 1);
+        } else {
+            atomic_fetch_add(&failed, 1);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 16;
+    long total = argc > 2 ? atol(argv[2]) : 20000;
+    bench_t bench = {.alias = argc > 3 ? argv[3] : "s01", .port = argc > 4 ? atoi(argv[4]) : 49200};
+    if (threads <= 0 || total < threads) {
+        printf("USE: %s [THREADS] [HANDSHAKES] [ALIAS] [PORT]\n", argv[0]);
+        return 1;
+    }
+    bench.per_thread = total / threads;
+
+    pthread_t* ids = malloc(threads * sizeof(pthread_t));
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&ids[i], NULL, clientThread, &bench);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(start, end);
+    long ok = atomic_load(&succeeded);
+    printf("[*] %d threads: %ld ok, %ld busy, %ld failed in %.3f s (%.0f handshakes/s)\n", threads, ok,
+           atomic_load(&busy), atomic_load(&failed), seconds, ok / seconds);
+    free(ids);
+    return 0;
+}
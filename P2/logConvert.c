@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "clientLog.h"
+
+//logConvert.c
+
+/*
+    Convierte la bitácora binaria de los clientes (CLIENT_LOG_FORMAT=binary) al formato de texto de
+    clientLog.txt y la escribe en la salida estándar.
+    Compilar: gcc -Wall -O2 -o logConvert logConvert.c
+    Uso: ./logConvert [clientLog.bin] >> clientLog.txt
+*/
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : LOG_BINARY_FILE;
+    FILE *log_file = fopen(path, "rb");
+    if (!log_file) {
+        perror("Error opening log");
+        return 1;
+    }
+
+    unsigned char head[LOG_RECORD_HEAD];
+    char status[LOG_MAX_FIELD + 1];
+    char server[LOG_MAX_FIELD + 1];
+    char filename[LOG_MAX_FIELD + 1];
+    time_t cached_second = -1;
+    char timestamp[64] = {0};
+    long records = 0;
+
+    while (fread(head, 1, sizeof(head), log_file) == sizeof(head)) {
+        if (head[0] != LOG_RECORD_MAGIC) {
+            fprintf(stderr, "[-] Invalid record after %ld records\n", records);
+            fclose(log_file);
+            return 1;
+        }
+        size_t status_len = head[2];
+        size_t server_len = head[3];
+        size_t filename_len = (size_t)head[4] << 8 | head[5];
+        uint64_t seconds = 0;
+        for (int i = 0; i < 8; i++) {
+            seconds = seconds << 8 | head[6 + i];
+        }
+        if (filename_len > LOG_MAX_FIELD ||
+            fread(status, 1, status_len, log_file) != status_len ||
+            fread(server, 1, server_len, log_file) != server_len ||
+            fread(filename, 1, filename_len, log_file) != filename_len) {
+            fprintf(stderr, "[-] Truncated record after %ld records\n", records);
+            fclose(log_file);
+            return 1;
+        }
+        status[status_len] = '\0';
+        server[server_len] = '\0';
+        filename[filename_len] = '\0';
+
+        const char *status_name = logStatusName(head[1]);
+        if (status_name == NULL) {
+            status_name = status;
+        }
+
+        time_t now = (time_t)seconds;
+        if (now != cached_second) {
+            struct tm t;
+            localtime_r(&now, &t);
+            strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &t);
+            cached_second = now;
+        }
+        printf("%s | %s | %s | %s\n", timestamp, status_name, filename, server);
+        records++;
+    }
+
+    fclose(log_file);
+    return 0;
+}
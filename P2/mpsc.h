@@ -0,0 +1,89 @@
+#ifndef MPSC_H
+#define MPSC_H
+
+/*
+    Cola intrusiva de varios productores y un solo consumidor sin candados. Los productores (los
+    reactores que encolan conexiones) solo hacen un intercambio atómico sobre head, así que encolar
+    es O(1) y nunca se bloquea. El consumidor (el hilo del servidor dueño de la cola) es el único
+    que mueve tail. El nodo stub permite que la cola nunca quede vacía por dentro.
+    Cada elemento lleva un mpsc_node_t como primer campo y se convierte de vuelta con un cast.
+*/
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+typedef struct mpsc_node {
+    _Atomic(struct mpsc_node *) next;
+} mpsc_node_t;
+
+typedef struct {
+    _Atomic(mpsc_node_t *) head;
+    mpsc_node_t *tail;
+    mpsc_node_t stub;
+} mpsc_queue_t;
+
+static inline void mpscInit(mpsc_queue_t *queue) {
+    atomic_store_explicit(&queue->stub.next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&queue->head, &queue->stub, memory_order_relaxed);
+    queue->tail = &queue->stub;
+}
+
+/*
+    Función que agrega un nodo al final. La pueden llamar varios hilos a la vez
+*/
+static inline void mpscPush(mpsc_queue_t *queue, mpsc_node_t *node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    mpsc_node_t *prev = atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/*
+    Función que espera a que el productor que ya tomó head termine de enlazar su nodo. Entre el
+    intercambio y el enlace solo hay una instrucción, así que la espera es muy corta
+*/
+static inline mpsc_node_t *mpscWaitNext(mpsc_node_t *node) {
+    mpsc_node_t *next;
+    while ((next = atomic_load_explicit(&node->next, memory_order_acquire)) == NULL) {
+        sched_yield();
+    }
+    return next;
+}
+
+/*
+    Función que saca el primer nodo o regresa NULL si la cola está vacía. Solo la llama el consumidor
+*/
+static inline mpsc_node_t *mpscPop(mpsc_queue_t *queue) {
+    mpsc_node_t *tail = queue->tail;
+    mpsc_node_t *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &queue->stub) {
+        if (next == NULL) {
+            if (atomic_load_explicit(&queue->head, memory_order_acquire) == tail) {
+                return NULL;
+            }
+            next = mpscWaitNext(tail);
+        }
+        queue->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+
+    // tail es el último nodo; si otro productor ya lo pasó esperamos su enlace
+    if (atomic_load_explicit(&queue->head, memory_order_acquire) != tail) {
+        queue->tail = mpscWaitNext(tail);
+        return tail;
+    }
+
+    // Para sacar el último nodo ponemos el stub detrás de él
+    mpscPush(queue, &queue->stub);
+    queue->tail = mpscWaitNext(tail);
+    return tail;
+}
+
+#endif
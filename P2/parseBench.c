@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "protocol.h"
+
+#define BUFFER_SIZE 1024
+
+//parseBench.c
+
+/*
+    Compara cuánto tarda el servidor en separar un mensaje con sscanf, con el parser del formato
+    alias|archivo|contenido de protocol.h y con el frame binario. Cada parser revisa el mismo
+    contenido muchas veces y se reporta mensajes y megabytes por segundo.
+    Compilar: gcc -Wall -O2 -o parseBench parseBench.c
+*/
+
+double elapsedSeconds(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void report(const char *name, long iterations, size_t message_len, double seconds, size_t check) {
+    printf("[*] %-8s %10.0f msgs/s %9.1f MB/s (check %zu)\n", name, iterations / seconds,
+           iterations * (double)message_len / seconds / 1e6, check);
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    size_t content_len = argc > 2 ? (size_t)atol(argv[2]) : 900;
+    if (iterations <= 0 || content_len == 0 || content_len >= BUFFER_SIZE - 64) {
+        printf("USE: %s [ITERATIONS] [CONTENT_BYTES < %d]\n", argv[0], BUFFER_SIZE - 64);
+        return 1;
+    }
+
+    char content[BUFFER_SIZE];
+    for (size_t i = 0; i < content_len; i++) {
+        content[i] = 'a' + i % 26;
+    }
+
+    char legacy[BUFFER_SIZE * 2];
+    char framed[BUFFER_SIZE * 2];
+    size_t legacy_len = protocolEncode(legacy, sizeof(legacy), false, "s01", "saludo1.txt", content, content_len, 0);
+    size_t framed_len = protocolEncode(framed, sizeof(framed), true, "s01", "saludo1.txt", content, content_len, 0);
+    legacy[legacy_len] = '\0';
+    printf("[*] %ld iterations, %zu content bytes\n", iterations, content_len);
+
+    struct timespec start, end;
+    // check acumula lo que se leyó y los punteros volatile evitan que el compilador saque el
+    // parser del ciclo
+    size_t check = 0;
+    const char *volatile legacy_src = legacy;
+    const char *volatile framed_src = framed;
+
+    // sscanf necesita el buffer terminado en cero y copia cada parte
+    char alias[32];
+    char filename[256];
+    char file_content[BUFFER_SIZE];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        if (sscanf(legacy_src, "%31[^|]|%255[^|]|%[^\n]", alias, filename, file_content) == 3) {
+            check += strlen(file_content);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("sscanf", iterations, legacy_len, elapsedSeconds(start, end), check);
+
+    frame_t frame;
+    check = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        if (frameParseLegacy(legacy_src, legacy_len, &frame) == FRAME_READY) {
+            check += frame.payload_len;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("legacy", iterations, legacy_len, elapsedSeconds(start, end), check);
+
+    check = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        if (frameParse(framed_src, framed_len, &frame) == FRAME_READY) {
+            check += frame.payload_len;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("frame", iterations, framed_len, elapsedSeconds(start, end), check);
+
+    return 0;
+}
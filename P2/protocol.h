@@ -0,0 +1,623 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/*
+    Formato de los mensajes entre clientes y servidores. Un frame binario lleva un encabezado fijo
+    de 20 bytes en orden de red seguido del alias, el nombre del archivo y el contenido, así que
+    el contenido puede traer |, saltos de línea o bytes en cero y puede llegar partido en varios
+    segmentos TCP. El formato anterior alias|archivo|contenido se sigue aceptando; se distinguen
+    por el primer byte, que en un frame nunca es un carácter ASCII.
+
+    Encabezado:
+        magic       u16   FRAME_MAGIC
+        version     u8    FRAME_VERSION
+        flags       u8    FRAME_FLAG_ACK pide confirmación con número de archivo
+        alias_len   u16
+        name_len    u16
+        seq         u32   número de archivo dentro de la conexión
+        payload_len u64
+
+    Con FRAME_FLAG_ACK el servidor responde cada archivo con una línea ACK|seq|mensaje, así un
+    cliente puede mandar varios archivos sin esperar y saber a cuál corresponde cada respuesta.
+
+    Si la cola del servidor está llena, en lugar del puerto dinámico o de la respuesta al primer
+    archivo llega BUSY|ms y la conexión se cierra. ms es cuánto sugiere esperar antes de reintentar.
+    Si el servidor no pudo abrir o escribir el archivo responde SAVE_ERROR_MSG en lugar del éxito.
+    Los clientes hacen el saludo, la subida y los reintentos con protocolUpload.
+
+    Los parsers no copian nada: el frame resultante apunta dentro del buffer de quien llama.
+    Como la longitud del contenido va en el encabezado, el contenido de un frame se puede mandar
+    con sendfile y guardar por bloques de FRAME_CHUNK_SIZE sin tener nunca el archivo entero en memoria.
+*/
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FRAME_MAGIC 0xF17E
+#define FRAME_VERSION 1
+#define FRAME_HEADER_SIZE 20
+#define FRAME_MAX_ALIAS 31
+#define FRAME_MAX_NAME 255
+#define FRAME_MAX_HEAD (FRAME_HEADER_SIZE + FRAME_MAX_ALIAS + FRAME_MAX_NAME)
+#define FRAME_CHUNK_SIZE 65536
+#define LEGACY_MAX_CONTENT 1023
+#define FRAME_FLAG_ACK 0x01
+#define BUSY_PREFIX "BUSY|"
+#define SAVE_ERROR_MSG "ERROR - Could not save file"
+#define BUSY_MAX_RETRIES 6
+#define BUSY_MAX_BACKOFF_MS 10000
+
+typedef enum {
+    FRAME_INCOMPLETE,
+    FRAME_READY,
+    FRAME_INVALID
+} frame_status_t;
+
+/*
+    Mensaje ya separado en sus partes. frame_len es lo que ocupa el mensaje completo en el buffer
+    y head_len lo que ocupan el encabezado y los nombres, el contenido empieza justo después
+*/
+typedef struct {
+    bool binary;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t seq;
+    const char *alias;
+    size_t alias_len;
+    const char *filename;
+    size_t name_len;
+    const char *payload;
+    uint64_t payload_len;
+    size_t head_len;
+    uint64_t frame_len;
+} frame_t;
+
+static inline uint16_t frameGet16(const unsigned char *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t frameGet32(const unsigned char *p) {
+    return (uint32_t)frameGet16(p) << 16 | frameGet16(p + 2);
+}
+
+static inline uint64_t frameGet64(const unsigned char *p) {
+    return (uint64_t)frameGet32(p) << 32 | frameGet32(p + 4);
+}
+
+static inline void framePut16(unsigned char *p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+}
+
+static inline void framePut32(unsigned char *p, uint32_t value) {
+    framePut16(p, value >> 16);
+    framePut16(p + 2, value & 0xFFFF);
+}
+
+static inline void framePut64(unsigned char *p, uint64_t value) {
+    framePut32(p, value >> 32);
+    framePut32(p + 4, value & 0xFFFFFFFF);
+}
+
+/*
+    Función que indica si el buffer empieza con un frame binario
+*/
+static inline bool frameIsBinary(const char *buf, size_t len) {
+    return len > 0 && (unsigned char)buf[0] == FRAME_MAGIC >> 8;
+}
+
+/*
+    Función que lee el encabezado y los nombres de un frame binario. Con READY ya se conoce todo
+    el frame aunque el contenido todavía no haya llegado
+*/
+static inline frame_status_t frameParseHead(const char *buf, size_t len, frame_t *frame) {
+    const unsigned char *p = (const unsigned char *)buf;
+    memset(frame, 0, sizeof(*frame));
+    frame->binary = true;
+
+    if (len < FRAME_HEADER_SIZE) {
+        // Con los primeros bytes ya podemos descartar basura
+        if ((len >= 1 && p[0] != FRAME_MAGIC >> 8) || (len >= 2 && frameGet16(p) != FRAME_MAGIC)) {
+            return FRAME_INVALID;
+        }
+        return FRAME_INCOMPLETE;
+    }
+    if (frameGet16(p) != FRAME_MAGIC || p[2] != FRAME_VERSION) {
+        return FRAME_INVALID;
+    }
+
+    frame->version = p[2];
+    frame->flags = p[3];
+    frame->alias_len = frameGet16(p + 4);
+    frame->name_len = frameGet16(p + 6);
+    frame->seq = frameGet32(p + 8);
+    frame->payload_len = frameGet64(p + 12);
+    if (frame->alias_len == 0 || frame->alias_len > FRAME_MAX_ALIAS ||
+        frame->name_len == 0 || frame->name_len > FRAME_MAX_NAME) {
+        return FRAME_INVALID;
+    }
+
+    frame->head_len = FRAME_HEADER_SIZE + frame->alias_len + frame->name_len;
+    frame->frame_len = frame->head_len + frame->payload_len;
+    if (len < frame->head_len) {
+        return FRAME_INCOMPLETE;
+    }
+    frame->alias = buf + FRAME_HEADER_SIZE;
+    frame->filename = frame->alias + frame->alias_len;
+    frame->payload = buf + frame->head_len;
+    return FRAME_READY;
+}
+
+/*
+    Función que revisa si ya llegó un frame binario completo. Si falta algo se puede volver a
+    llamar cuando lleguen más bytes, frame_len dice cuántos hacen falta en total
+*/
+static inline frame_status_t frameParse(const char *buf, size_t len, frame_t *frame) {
+    frame_status_t status = frameParseHead(buf, len, frame);
+    if (status == FRAME_READY && len < frame->frame_len) {
+        return FRAME_INCOMPLETE;
+    }
+    return status;
+}
+
+/*
+    Función que separa un mensaje alias|archivo|contenido. El contenido llega hasta el primer salto
+    de línea y el mensaje ocupa todo el buffer, igual que con sscanf. Como no trae longitud, un
+    mensaje al que le faltan partes se reporta como incompleto
+*/
+static inline frame_status_t frameParseLegacy(const char *buf, size_t len, frame_t *frame) {
+    memset(frame, 0, sizeof(*frame));
+
+    const char *alias_end = memchr(buf, '|', len);
+    if (alias_end == NULL) {
+        return len > FRAME_MAX_ALIAS ? FRAME_INVALID : FRAME_INCOMPLETE;
+    }
+    const char *name = alias_end + 1;
+    const char *end = buf + len;
+    const char *name_end = memchr(name, '|', end - name);
+    if (name_end == NULL) {
+        return end - name > FRAME_MAX_NAME ? FRAME_INVALID : FRAME_INCOMPLETE;
+    }
+    const char *content = name_end + 1;
+    const char *content_end = memchr(content, '\n', end - content);
+    if (content_end == NULL) {
+        content_end = end;
+    }
+
+    frame->alias = buf;
+    frame->alias_len = alias_end - buf;
+    frame->filename = name;
+    frame->name_len = name_end - name;
+    frame->payload = content;
+    frame->payload_len = content_end - content;
+    frame->head_len = content - buf;
+    frame->frame_len = len;
+    if (frame->alias_len == 0 || frame->alias_len > FRAME_MAX_ALIAS ||
+        frame->name_len == 0 || frame->name_len > FRAME_MAX_NAME) {
+        return FRAME_INVALID;
+    }
+    return frame->payload_len > 0 ? FRAME_READY : FRAME_INCOMPLETE;
+}
+
+/*
+    Función que separa el siguiente mensaje del buffer en cualquiera de los dos formatos
+*/
+static inline frame_status_t protocolParse(const char *buf, size_t len, frame_t *frame) {
+    if (frameIsBinary(buf, len)) {
+        return frameParse(buf, len, frame);
+    }
+    return frameParseLegacy(buf, len, frame);
+}
+
+/*
+    Igual que protocolParse, pero a un frame binario solo le pide el alias y el nombre. Sirve para
+    decidir a qué servidor va una conexión sin esperar el contenido
+*/
+static inline frame_status_t protocolParseHead(const char *buf, size_t len, frame_t *frame) {
+    if (frameIsBinary(buf, len)) {
+        return frameParseHead(buf, len, frame);
+    }
+    return frameParseLegacy(buf, len, frame);
+}
+
+/*
+    Función que escribe el encabezado y los nombres de un frame. Regresa los bytes escritos, o 0 si
+    los nombres son demasiado largos o no caben en out. El contenido se manda después tal cual
+*/
+static inline size_t frameEncodeHead(char *out, size_t size, const char *alias, const char *filename,
+                                     uint64_t payload_len, uint32_t seq, uint8_t flags) {
+    size_t alias_len = strlen(alias);
+    size_t name_len = strlen(filename);
+    size_t head_len = FRAME_HEADER_SIZE + alias_len + name_len;
+    if (alias_len == 0 || alias_len > FRAME_MAX_ALIAS || name_len == 0 || name_len > FRAME_MAX_NAME ||
+        head_len > size) {
+        return 0;
+    }
+
+    unsigned char *p = (unsigned char *)out;
+    framePut16(p, FRAME_MAGIC);
+    p[2] = FRAME_VERSION;
+    p[3] = flags;
+    framePut16(p + 4, alias_len);
+    framePut16(p + 6, name_len);
+    framePut32(p + 8, seq);
+    framePut64(p + 12, payload_len);
+    memcpy(out + FRAME_HEADER_SIZE, alias, alias_len);
+    memcpy(out + FRAME_HEADER_SIZE + alias_len, filename, name_len);
+    return head_len;
+}
+
+/*
+    Función que arma un mensaje completo para los clientes. Con framed se usa el frame binario,
+    si no el formato alias|archivo|contenido para los servidores anteriores. Regresa la longitud
+    del mensaje o 0 si no cabe
+*/
+static inline size_t protocolEncode(char *out, size_t size, bool framed, const char *alias, const char *filename,
+                                    const char *content, size_t content_len, uint32_t seq) {
+    if (!framed) {
+        int written = snprintf(out, size, "%s|%s|%.*s", alias, filename, (int)content_len, content);
+        if (written < 0) {
+            return 0;
+        }
+        return (size_t)written < size ? (size_t)written : size - 1;
+    }
+
+    size_t head_len = frameEncodeHead(out, size, alias, filename, content_len, seq, 0);
+    if (head_len == 0 || head_len + content_len > size) {
+        return 0;
+    }
+    memcpy(out + head_len, content, content_len);
+    return head_len + content_len;
+}
+
+/*
+    Función que manda todo el buffer aunque send lo acepte por partes
+*/
+static inline int protocolSendAll(int sock, const char *buf, size_t len, int flags) {
+    while (len > 0) {
+        ssize_t sent = send(sock, buf, len, flags | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += sent;
+        len -= sent;
+    }
+    return 0;
+}
+
+/*
+    Función que manda length bytes del archivo directo del descriptor al socket con sendfile, sin
+    copiarlos a un buffer del proceso. Si el archivo no admite sendfile se mapea en memoria y se
+    manda desde ahí
+*/
+static inline int protocolSendBody(int sock, int file_fd, uint64_t length) {
+    off_t offset = 0;
+    while ((uint64_t)offset < length) {
+        ssize_t sent = sendfile(sock, file_fd, &offset, length - offset);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            break;
+        }
+        if (sent <= 0) {
+            return -1;
+        }
+    }
+    if ((uint64_t)offset == length) {
+        return 0;
+    }
+
+    char *view = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file_fd, 0);
+    if (view == MAP_FAILED) {
+        return -1;
+    }
+    int result = protocolSendAll(sock, view + offset, length - offset, 0);
+    munmap(view, length);
+    return result;
+}
+
+/*
+    Función que manda un encabezado ya armado y después hasta max_content bytes del archivo con
+    protocolSendBody. MSG_MORE hace que el encabezado espere al contenido y salgan juntos, así un
+    servidor que lee el mensaje con un solo recv lo recibe completo. Regresa 0 si se envió todo o
+    -1 si hubo error
+*/
+static inline int protocolSendHeaded(int sock, const char *head, size_t head_len, FILE *fp, uint64_t max_content) {
+    int file_fd = fileno(fp);
+    struct stat file_stat;
+    if (fstat(file_fd, &file_stat) < 0) {
+        return -1;
+    }
+    uint64_t length = (uint64_t)file_stat.st_size < max_content ? (uint64_t)file_stat.st_size : max_content;
+
+    if (protocolSendAll(sock, head, head_len, length > 0 ? MSG_MORE : 0) < 0) {
+        return -1;
+    }
+    return protocolSendBody(sock, file_fd, length);
+}
+
+/*
+    Función que manda un archivo completo con protocolSendHeaded. Con framed el encabezado lleva el
+    tamaño del archivo, así que puede ser de cualquier tamaño. Sin framed se manda alias|archivo|contenido
+    con los primeros LEGACY_MAX_CONTENT bytes, como antes. Regresa 0 si se envió todo o -1 si hubo error
+*/
+static inline int protocolSendFile(int sock, FILE *fp, bool framed, const char *alias, const char *filename,
+                                   uint32_t seq, uint8_t flags) {
+    int file_fd = fileno(fp);
+    struct stat file_stat;
+    if (fstat(file_fd, &file_stat) < 0) {
+        return -1;
+    }
+    uint64_t length = file_stat.st_size;
+
+    char head[FRAME_MAX_HEAD + 3];
+    size_t head_len;
+    if (framed) {
+        head_len = frameEncodeHead(head, sizeof(head), alias, filename, length, seq, flags);
+    } else {
+        if (length > LEGACY_MAX_CONTENT) {
+            length = LEGACY_MAX_CONTENT;
+        }
+        int written = snprintf(head, sizeof(head), "%s|%s|", alias, filename);
+        head_len = written > 0 && (size_t)written < sizeof(head) ? (size_t)written : 0;
+    }
+    if (head_len == 0) {
+        return -1;
+    }
+    return protocolSendHeaded(sock, head, head_len, fp, length);
+}
+
+/*
+    Función que arma la confirmación de un archivo. Regresa su longitud o 0 si no cabe
+*/
+static inline size_t ackFormat(char *out, size_t size, uint32_t seq, const char *message) {
+    int written = snprintf(out, size, "ACK|%u|%s\n", seq, message);
+    return written > 0 && (size_t)written < size ? (size_t)written : 0;
+}
+
+/*
+    Función que separa la siguiente confirmación ACK|seq|mensaje del buffer. Regresa los bytes que
+    ocupa la línea, 0 si todavía no llega completa o -1 si no es una confirmación
+*/
+static inline int ackParse(const char *buf, size_t len, uint32_t *seq, const char **message, size_t *message_len) {
+    size_t prefix = len < 4 ? len : 4;
+    if (memcmp(buf, "ACK|", prefix) != 0) {
+        return -1;
+    }
+    const char *end = memchr(buf, '\n', len);
+    if (end == NULL) {
+        return 0;
+    }
+
+    uint32_t value = 0;
+    const char *p = buf + 4;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (p == buf + 4 || p == end || *p != '|') {
+        return -1;
+    }
+    *seq = value;
+    *message = p + 1;
+    *message_len = end - p - 1;
+    return end - buf + 1;
+}
+
+/*
+    Función que arma la respuesta BUSY|ms. Regresa su longitud o 0 si no cabe
+*/
+static inline size_t busyFormat(char *out, size_t size, int retry_ms) {
+    int written = snprintf(out, size, BUSY_PREFIX "%d", retry_ms);
+    return written > 0 && (size_t)written < size ? (size_t)written : 0;
+}
+
+/*
+    Función que revisa si la respuesta del servidor es BUSY|ms, sola o dentro de un ACK. Regresa los
+    milisegundos sugeridos (al menos 1) o -1 si no es BUSY
+*/
+static inline int busyParse(const char *buf, size_t len) {
+    uint32_t seq;
+    const char *message = buf;
+    size_t message_len = len;
+    if (ackParse(buf, len, &seq, &message, &message_len) <= 0) {
+        message = buf;
+        message_len = len;
+    }
+    size_t prefix = strlen(BUSY_PREFIX);
+    if (message_len <= prefix || memcmp(message, BUSY_PREFIX, prefix) != 0) {
+        return -1;
+    }
+    int retry_ms = 0;
+    for (size_t i = prefix; i < message_len && message[i] >= '0' && message[i] <= '9'; i++) {
+        retry_ms = retry_ms * 10 + (message[i] - '0');
+        if (retry_ms > BUSY_MAX_BACKOFF_MS) {
+            retry_ms = BUSY_MAX_BACKOFF_MS;
+        }
+    }
+    return retry_ms > 0 ? retry_ms : 1;
+}
+
+/*
+    Función que revisa sin bloquear si el servidor ya respondió BUSY. Se usa cuando falla el envío:
+    el servidor que rechaza deja de leer y cierra, pero su respuesta sigue en el socket
+*/
+static inline int busyPending(int sock) {
+    char reply[64];
+    ssize_t bytes = recv(sock, reply, sizeof(reply), MSG_DONTWAIT);
+    return bytes > 0 ? busyParse(reply, bytes) : -1;
+}
+
+/*
+    Función que espera antes de reintentar una subida rechazada con BUSY. La espera sugerida se
+    duplica en cada intento hasta BUSY_MAX_BACKOFF_MS y se elige al azar entre la mitad y el total,
+    así los clientes rechazados al mismo tiempo no vuelven todos juntos
+*/
+static inline void busyBackoff(int retry_ms, int attempt) {
+    long delay = retry_ms;
+    for (int i = 0; i < attempt && delay < BUSY_MAX_BACKOFF_MS; i++) {
+        delay *= 2;
+    }
+    if (delay > BUSY_MAX_BACKOFF_MS) {
+        delay = BUSY_MAX_BACKOFF_MS;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    unsigned int seed = (unsigned int)now.tv_nsec ^ (unsigned int)getpid() ^ (unsigned int)(uintptr_t)&now;
+    long wait_ms = delay / 2 + rand_r(&seed) % (delay - delay / 2 + 1);
+    struct timespec pause = {wait_ms / 1000, (wait_ms % 1000) * 1000000};
+    while (nanosleep(&pause, &pause) < 0 && errno == EINTR) {
+    }
+}
+
+/*
+    Función que se conecta a un puerto del servidor. Regresa el socket o -1 si hubo error
+*/
+static inline int protocolConnect(struct in_addr server_addr, int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("Socket creation failed");
+        return -1;
+    }
+    struct sockaddr_in serv_addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr = server_addr};
+    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("Connection failed");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/*
+    Función que hace el saludo: se conecta al puerto base y recibe el puerto dinámico, o BUSY si el
+    servidor ya no admite más conexiones. Si el servidor ofrece INLINE el archivo va por la misma
+    conexión; si no, nos conectamos al puerto dinámico. framed indica si el servidor anunció frames
+    binarios. Regresa 0 con el socket listo en sock, -1 si hubo error o los milisegundos que sugiere
+    esperar el servidor si respondió BUSY
+*/
+static inline int protocolGreet(struct in_addr server_addr, int port, int *sock, bool *framed) {
+    int client_sock = protocolConnect(server_addr, port);
+    if (client_sock < 0) {
+        return -1;
+    }
+
+    char greeting[64];
+    ssize_t bytes = recv(client_sock, greeting, sizeof(greeting) - 1, 0);
+    if (bytes <= 0) {
+        perror("Error receiving port");
+        close(client_sock);
+        return -1;
+    }
+    greeting[bytes] = '\0';
+    int busy_ms = busyParse(greeting, bytes);
+    int dynamic_port;
+    if (busy_ms > 0 || sscanf(greeting, "DYNAMIC_PORT|%d", &dynamic_port) != 1) {
+        if (busy_ms < 0) {
+            printf("Invalid greeting from server: %s\n", greeting);
+        }
+        close(client_sock);
+        return busy_ms;
+    }
+
+    *framed = strstr(greeting, "|FRAME") != NULL;
+    if (strstr(greeting, "|INLINE") == NULL) {
+        close(client_sock);
+        client_sock = protocolConnect(server_addr, dynamic_port);
+        if (client_sock < 0) {
+            return -1;
+        }
+    }
+    *sock = client_sock;
+    return 0;
+}
+
+/*
+    Función que manda un archivo y espera la respuesta del servidor, que queda en response. El archivo
+    se manda por bloques, así que no importa su tamaño. Si la cola del servidor está llena deja de leer
+    y el envío falla, pero su respuesta BUSY ya está en el socket. Regresa 0 si llegó la respuesta,
+    -1 si hubo error o los milisegundos que sugiere esperar el servidor si respondió BUSY
+*/
+static inline int protocolSendWait(int sock, FILE *fp, bool framed, const char *alias, const char *filename,
+                                   uint32_t seq, char *response, size_t size) {
+    if (protocolSendFile(sock, fp, framed, alias, filename, seq, 0) < 0) {
+        int busy_ms = busyPending(sock);
+        if (busy_ms < 0) {
+            perror("Send failed");
+        }
+        return busy_ms;
+    }
+
+    ssize_t bytes = recv(sock, response, size - 1, 0);
+    if (bytes <= 0) {
+        printf("No response from server\n");
+        return -1;
+    }
+    response[bytes] = '\0';
+    int busy_ms = busyParse(response, bytes);
+    return busy_ms > 0 ? busy_ms : 0;
+}
+
+/*
+    Función que da la etiqueta del registro para la respuesta del servidor a un archivo
+*/
+static inline const char *protocolOutcome(const char *message, size_t len) {
+    size_t error_len = strlen(SAVE_ERROR_MSG);
+    if (len >= error_len && memcmp(message, SAVE_ERROR_MSG, error_len) == 0) {
+        return "ERROR";
+    }
+    if (len >= 8 && memcmp(message, "REJECTED", 8) == 0) {
+        return "REJECTED";
+    }
+    return "SUCCESS";
+}
+
+// Subida sobre una conexión ya saludada. Regresa 0, -1 o los milisegundos de un BUSY
+typedef int (*upload_fn_t)(int sock, bool framed, void *arg);
+
+/*
+    Función que sube con upload después del saludo. Mientras el servidor responda BUSY esperamos lo
+    que sugiere con busyBackoff y reintentamos, hasta BUSY_MAX_RETRIES veces. server solo se usa en
+    los mensajes. Regresa 0 si terminó, -1 si hubo error o los milisegundos del último BUSY si se
+    acabaron los intentos
+*/
+static inline int protocolUpload(struct in_addr server_addr, int port, const char *server, upload_fn_t upload,
+                                 void *arg) {
+    int result = 0;
+    for (int attempt = 0; attempt <= BUSY_MAX_RETRIES; attempt++) {
+        if (attempt > 0) {
+            printf("Server %s busy, retrying in about %d ms\n", server, result);
+            busyBackoff(result, attempt - 1);
+        }
+        int sock;
+        bool framed;
+        result = protocolGreet(server_addr, port, &sock, &framed);
+        if (result == 0) {
+            result = upload(sock, framed, arg);
+            close(sock);
+        }
+        if (result <= 0) {
+            return result;
+        }
+    }
+    printf("Server %s still busy, giving up\n", server);
+    return result;
+}
+
+#endif
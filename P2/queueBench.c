@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "mpsc.h"
+
+//queueBench.c
+
+/*
+    Compara la cola de conexiones anterior (lista con mutex que recorre hasta el final para encolar)
+    contra la cola mpsc.h. Varios hilos productores, como los reactores, encolan nodos mientras un
+    solo consumidor, como el hilo del servidor, los saca. Se reportan operaciones por segundo.
+    Compilar: gcc -Wall -O2 -pthread -o queueBench queueBench.c
+*/
+
+typedef struct bench_node {
+    mpsc_node_t link;
+    struct bench_node* next;
+    long value;
+} bench_node_t;
+
+typedef struct {
+    bool use_mpsc;
+    int producers;
+    long per_producer;
+    bench_node_t* nodes;
+} bench_t;
+
+mpsc_queue_t mpsc_queue;
+bench_node_t* list_head = NULL;
+pthread_mutex_t list_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    bench_t* bench;
+    int index;
+} producer_arg_t;
+
+double elapsedSeconds(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/*
+    Función que encola como lo hacía addQueue: toma el mutex y recorre hasta el último nodo
+*/
+void listPush(bench_node_t* node) {
+    node->next = NULL;
+    pthread_mutex_lock(&list_mutex);
+    if (list_head == NULL) {
+        list_head = node;
+    } else {
+        bench_node_t* current = list_head;
+        while (current->next != NULL) {
+            current = current->next;
+        }
+        current->next = node;
+    }
+    pthread_mutex_unlock(&list_mutex);
+}
+
+bench_node_t* listPop(void) {
+    pthread_mutex_lock(&list_mutex);
+    bench_node_t* node = list_head;
+    if (node != NULL) {
+        list_head = node->next;
+    }
+    pthread_mutex_unlock(&list_mutex);
+    return node;
+}
+
+void* producerThread(void* arg) {
+    producer_arg_t* producer = (producer_arg_t*)arg;
+    bench_t* bench = producer->bench;
+    bench_node_t* nodes = bench->nodes + producer->index * bench->per_producer;
+    for (long i = 0; i < bench->per_producer; i++) {
+        nodes[i].value = i;
+        if (bench->use_mpsc) {
+            mpscPush(&mpsc_queue, &nodes[i].link);
+        } else {
+            listPush(&nodes[i]);
+        }
+    }
+    return NULL;
+}
+
+/*
+    Función que lanza los productores y consume en el hilo principal hasta sacar todos los nodos
+*/
+void runBench(bench_t* bench, const char* name) {
+    long total = bench->producers * bench->per_producer;
+    pthread_t* threads = malloc(bench->producers * sizeof(pthread_t));
+    producer_arg_t* args = malloc(bench->producers * sizeof(producer_arg_t));
+    mpscInit(&mpsc_queue);
+    list_head = NULL;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < bench->producers; i++) {
+        args[i].bench = bench;
+        args[i].index = i;
+        pthread_create(&threads[i], NULL, producerThread, &args[i]);
+    }
+
+    long popped = 0;
+    long empty_polls = 0;
+    long check = 0;
+    while (popped < total) {
+        bench_node_t* node = bench->use_mpsc ? (bench_node_t*)mpscPop(&mpsc_queue) : listPop();
+        if (node == NULL) {
+            empty_polls++;
+            continue;
+        }
+        check += node->value;
+        popped++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < bench->producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double seconds = elapsedSeconds(start, end);
+    printf("[*] %-6s %10.0f ops/s  %.3f s  (empty polls %ld, check %ld)\n", name, total / seconds, seconds,
+           empty_polls, check);
+    free(threads);
+    free(args);
+}
+
+int main(int argc, char *argv[]) {
+    int producers = argc > 1 ? atoi(argv[1]) : 8;
+    long per_producer = argc > 2 ? atol(argv[2]) : 200000;
+    if (producers <= 0 || per_producer <= 0) {
+        printf("USE: %s [PRODUCERS] [NODES_PER_PRODUCER]\n", argv[0]);
+        return 1;
+    }
+
+    bench_t bench = {.producers = producers, .per_producer = per_producer};
+    bench.nodes = calloc(producers * per_producer, sizeof(bench_node_t));
+    if (bench.nodes == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    printf("[*] %d producers, %ld nodes each\n", producers, per_producer);
+
+    bench.use_mpsc = false;
+    runBench(&bench, "mutex");
+    bench.use_mpsc = true;
+    runBench(&bench, "mpsc");
+
+    free(bench.nodes);
+    return 0;
+}
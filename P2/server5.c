@@ -1,6 +1,8 @@
+#define _GNU_SOURCE
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,458 +12,3662 @@
 #include <sys/stat.h>
 #include <pthread.h>
 #include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <time.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include "uring.h"
+#include "protocol.h"
+#include "mpsc.h"
+#include "timerWheel.h"
 
 #define BUFFER_SIZE 1024
 #define server_port 49200 // Puerto base 
-#define QUANTUM_TIME 15
+#define DEFAULT_QUANTUM_MS 15000
+#define MAX_EVENTS 64
+#define URING_ENTRIES 256
+#define DEFAULT_POOL_SIZE 32
+#define POOL_BACKLOG 16
+#define DRR_QUANTUM_BYTES (4 * 1024 * 1024)
+#define SERVER_CHUNK 64
+#define MAX_SERVER_CHUNKS 1024
+#define REGISTRY_INITIAL_SLOTS 64
+#define HANDLER_QUEUE_PER_WORKER 4
+#define BUSY_MIN_RETRY_MS 10
+#define BUSY_MAX_RETRY_MS 5000
+#define TIMER_TICK_MS 100
+#define DEFAULT_HANDSHAKE_TIMEOUT_MS 10000
+#define DEFAULT_READ_TIMEOUT_MS 30000
+#define PORT_PROBE_LIMIT 64
 
 /*
-    Estructura para memoria compartida. Con esto nos aseguramos que solo un servidor
-    esté recibiendo archivos a la vez y que cada servidor espere su turno. Además notifica
-    a los demas servidores cuando es su turno.
+    Política de turnos. El hilo receptor la consulta al empezar el turno de un servidor, antes de
+    cada conexión y al terminar para elegir al siguiente. Los campos en NULL no hacen nada
+*/
+typedef struct {
+    const char* name;
+    // Milisegundos que puede durar el turno del servidor
+    int (*quantum)(int server_index);
+    void (*turnStart)(int server_index);
+    // Indica si el servidor todavía puede atender otra conexión en este turno
+    bool (*mayContinue)(int server_index);
+    // Registra los bytes recibidos en la conexión que se acaba de atender
+    void (*connectionDone)(int server_index, uint64_t bytes);
+    // Se llama con shared_mem->mutex tomado cuando el servidor suelta el turno
+    void (*turnEnd)(int server_index);
+    // Elige al siguiente servidor a partir del último que recibió turno, o -1 si no hay a quién
+    // dárselo; se llama con shared_mem->mutex tomado y debe costar O(1) por cambio de turno
+    int (*nextServer)(int server_index);
+} sched_policy_t;
+
+/*
+    Métricas de cada servidor para comparar políticas. Solo las modifica el hilo receptor que tiene
+    su turno; la espera es el tiempo desde que la conexión se encoló hasta que se empezó a atender
+*/
+typedef struct {
+    uint64_t connections;
+    uint64_t bytes;
+    uint64_t turns;
+    double held_seconds;
+    double busy_seconds;
+    double wait_seconds;
+    double max_wait_seconds;
+} sched_metrics_t;
+
+/*
+    Servidor lógico (alias). Su cola, su eventfd y su estado de turno se crean cuando el alias se
+    registra: al arrancar para los alias de la línea de comandos y con -A cuando llega la primera
+    conexión para un alias nuevo. Una vez registrado nunca se mueve ni se libera
+*/
+typedef struct server {
+    char name[FRAME_MAX_ALIAS + 1];
+    int index;
+    int weight;
+    // Cola de conexiones. Los reactores encolan y solo el receptor con su turno saca
+    mpsc_queue_t queue;
+    // Cuando la cola está vacía el receptor espera en event_fd y waiting le indica a los reactores
+    // que deben despertarlo al encolar
+    int event_fd;
+    atomic_int waiting;
+    // Conexiones encoladas, para saber a quién pasarle el turno sin revisar la cola
+    atomic_int pending;
+    // Conexiones admitidas que ningún receptor ha tomado, incluidas las que van en camino a su
+    // proceso (-P); con -l no pasan de queue_limit. busy_replies cuenta las que se rechazaron
+    atomic_int admitted;
+    atomic_ulong busy_replies;
+    // Conexiones atendidas y su tiempo en microsegundos. Son atómicos porque los acceptors los leen
+    // para calcular el BUSY|ms mientras el receptor o los manejadores los actualizan
+    atomic_ulong served;
+    atomic_ulong served_us;
+    // Tiene turno; ready indica que está en la lista de servidores con trabajo (modo -w)
+    atomic_bool receiving;
+    atomic_bool ready;
+    struct server* ready_next;
+    // Crédito de DRR. Es atómico porque con -h los manejadores lo descuentan mientras el receptor lo revisa
+    atomic_llong deficit;
+    sched_metrics_t metrics;
+    // Modo -P: proceso del servidor, socket por el que el acceptor le pasa las conexiones
+    // (channel[0] lo usa el acceptor, channel[1] el proceso) y aviso de que ya tiene turno
+    pid_t pid;
+    int channel[2];
+    bool granted;
+} server_t;
+
+/*
+    Registro de servidores. Los servidores viven en bloques de SERVER_CHUNK que no se mueven al
+    crecer, así que los receptores los leen por índice sin candado. La tabla hash (direccionamiento
+    abierto, índice + 1 y 0 para vacío) traduce el alias a su índice y se duplica al llenarse a la mitad
+*/
+typedef struct {
+    pthread_rwlock_t lock;
+    int* slots;
+    int slot_count;
+    server_t* chunks[MAX_SERVER_CHUNKS];
+    atomic_int count;
+} server_registry_t;
+
+/*
+    Estructura para memoria compartida. Hay max_receivers hilos receptores (-k) y cada uno tiene el
+    turno de un servidor a la vez, así que a lo más max_receivers servidores reciben archivos a la
+    vez (uno con -k 1). current_server es el último servidor que recibió turno. En modo -w los
+    servidores con conexiones pendientes y sin turno esperan en orden en la lista ready.
+    Con -P la estructura y los servidores viven en una región de shm_open que comparten los procesos
+    de cada servidor. El mutex es compartido entre procesos y robusto, y en vez de turn_cond los
+    procesos esperan con futex sobre turn_seq, que no se atora si muere un proceso que esperaba.
 */
 typedef struct {
     int current_server;
-    int receiving_server;
-    bool server_busy;
-    time_t turn_start_time;
-    //Mnejamos la sincronización donde los hilos de cada servidor esperan su turno
+    int max_receivers;
+    int active_receivers;
+    // Lista de servidores con trabajo; se modifica con el mutex y ready_count se lee sin él
+    server_t* ready_head;
+    server_t* ready_tail;
+    atomic_int ready_count;
+    atomic_int ready_waiters;
+    //Mnejamos la sincronización donde los receptores sin servidor esperan a que haya uno
     pthread_mutex_t mutex;
     pthread_cond_t turn_cond;
+    atomic_uint turn_seq;
+    // Política de turnos elegida al arrancar
+    const sched_policy_t* policy;
+    struct timespec started;
+    // Control de admisión: conexiones admitidas de todos los servidores (con -L no pasan de
+    // total_limit), clientes rechazados en el saludo y conexiones atendidas con su tiempo total,
+    // para estimar cuánto esperar antes de reintentar
+    atomic_int admitted;
+    atomic_ulong busy_replies;
+    atomic_ulong served;
+    atomic_ulong served_us;
+    // Conexiones cerradas por vencer su plazo de saludo, de espera en la cola o de lectura (-t)
+    atomic_ulong handshake_timeouts;
+    atomic_ulong queue_timeouts;
+    atomic_ulong read_timeouts;
+    // Puertos dinámicos que se saltaron porque otro socket los ocupaba y clientes que no recibieron puerto
+    atomic_ulong ports_skipped;
+    atomic_ulong ports_exhausted;
 } shared_memory_t;
 
+/*
+    Mapa de bits de los puertos dinámicos del rango -D. Un bit encendido es un puerto que se le dio
+    a un cliente o al pool y cuyo socket sigue abierto; se apaga al cerrarlo, en el hilo o proceso
+    que sea. Cada acceptor solo enciende bits de su parte del rango, así que buscar no necesita
+    candado; apagar es atómico porque lo hacen los receptores y, con -P, los procesos de los servidores.
+    Con -P los bits viven en la región compartida
+*/
+typedef struct {
+    int first;
+    int count;
+    _Atomic(uint64_t)* bits;
+} port_map_t;
+
+/*
+    Estado de una conexión de la cola frente a sus plazos. Una conexión que vence en la cola se
+    cierra ahí mismo y queda EXPIRED hasta que el receptor la saca y solo la libera
+*/
+typedef enum {
+    CONNECTION_QUEUED,
+    CONNECTION_SERVING,
+    CONNECTION_EXPIRED
+} connection_state_t;
+
 /*
     Estructura para cola de conexiones. Cada servidor tiene su propia cola donde se almacenan
-    las conexiones entrantes mientras espera su turno.
+    las conexiones entrantes mientras espera su turno. link va primero para convertir el nodo
+    de la cola de vuelta a la conexión. timer y state los protege deadline_mutex.
 */
 typedef struct connection_node {
+    mpsc_node_t link;
     int dynamic_client;
     int dynamic_sock;
     char target_server[32];
-    struct connection_node* next;
+    struct timespec enqueued;
+    timer_node_t timer;
+    connection_state_t state;
 } connection_node_t;
 
+/*
+    Tipos de descriptores que vigila el reactor. El socket base entrega puertos dinámicos,
+    los sockets dinámicos esperan a su cliente y los clientes esperan a que llegue el encabezado
+    del mensaje (frame o alias|archivo|contenido) para encolarse. Una conexión del puerto base que ya recibió su puerto
+    dinámico queda en REACTOR_HANDSHAKE: si el cliente manda ahí su encabezado (modo INLINE) la
+    subida sigue en esa misma conexión y se libera el puerto dinámico.
+*/
+typedef enum {
+    REACTOR_BASE,
+    REACTOR_DYNAMIC,
+    REACTOR_CLIENT,
+    REACTOR_HANDSHAKE
+} reactor_kind_t;
+
+/*
+    peer une el socket dinámico con la conexión del puerto base a la que se le asignó,
+    mientras ninguno de los dos haya terminado. timer es el plazo para que llegue el cliente
+    o su encabezado
+*/
+typedef struct reactor_conn {
+    reactor_kind_t kind;
+    int fd;
+    int dynamic_sock;
+    int pool_slot;
+    struct reactor_conn* peer;
+    struct reactor_conn* next_free;
+    timer_node_t timer;
+} reactor_conn_t;
+
+/*
+    Puerto dinámico del pool. Su socket escucha desde el arranque y nunca se cierra; assigned
+    indica que ya se le dio a un cliente que todavía no se conecta
+*/
+typedef struct {
+    int port;
+    int fd;
+    bool assigned;
+    void* conn;
+} pool_slot_t;
+
+/*
+    Estado del reactor epoll que es dueño de todos los sockets hasta que la conexión
+    se entrega a la cola de su servidor. Las conexiones que se dejan de vigilar se liberan
+    hasta terminar el lote de eventos, porque otro evento del mismo lote puede apuntarles.
+    Los puertos libres del pool se guardan en una pila para repartirlos en O(1). Cada acceptor
+    tiene su propio reactor y reparte puertos de un rango que no comparte con los demás;
+    port_cursor es donde sigue la búsqueda de un puerto libre en ese rango.
+    deadlines tiene los plazos de saludo de sus conexiones; solo la toca el hilo del acceptor
+*/
+typedef struct {
+    int index;
+    int epoll_fd;
+    int base_sock;
+    int port_first;
+    int port_count;
+    int port_cursor;
+    reactor_conn_t* dropped;
+    pool_slot_t* pool;
+    int pool_size;
+    int* free_slots;
+    int free_count;
+    timer_wheel_t deadlines;
+} reactor_t;
+
+/*
+    Conexión vigilada por el backend io_uring. Guarda sus propios buffers porque el kernel
+    escribe en ellos hasta que la operación se completa
+*/
+typedef struct uring_conn {
+    reactor_kind_t kind;
+    int fd;
+    int dynamic_sock;
+    int pool_slot;
+    bool retrying;
+    struct uring_conn* peer;
+    timer_node_t timer;
+    char buffer[BUFFER_SIZE];
+    struct __kernel_timespec retry_delay;
+} uring_conn_t;
+
+/*
+    Backend de E/S que se elige al arrancar. epoll usa recv/send bloqueantes al procesar,
+    io_uring envía aceptaciones, lecturas y escrituras de archivo en lotes
+*/
+typedef enum {
+    BACKEND_EPOLL,
+    BACKEND_URING
+} io_backend_t;
+
+/*
+    Camino para guardar el contenido que no llegó junto con el encabezado. splice lo mueve del socket
+    al archivo dentro del kernel a través de un pipe, copy lo pasa por el buffer de la conexión
+*/
+typedef enum {
+    RECV_SPLICE,
+    RECV_COPY
+} recv_path_t;
+
+io_backend_t io_backend = BACKEND_EPOLL;
+recv_path_t recv_path = RECV_SPLICE;
+int pool_size = DEFAULT_POOL_SIZE;
+// Manejadores que atienden en paralelo las conexiones del turno (-h); con 1 las atiende el receptor
+int handler_count = 1;
+// Límites de conexiones formadas por servidor (-l) y en total (-L); 0 es sin límite
+int queue_limit = 0;
+int total_limit = 0;
+int num_acceptors = 1;
+// Rango de puertos dinámicos (-D) y el mapa de los que están en uso
+int dynamic_first = server_port + 1;
+int dynamic_last = 65535;
+port_map_t port_map;
 shared_memory_t *shared_mem;
-char *server_names[4];
-// Inicializamos una cola para cada servidor donde se almacenan las conexiones entrantes
-connection_node_t* connection_queues[4] = {NULL}; 
-pthread_mutex_t queue_mutexes[4];
+server_registry_t registry;
+// Con -A los alias desconocidos se registran con la primera conexión que llega para ellos
+bool auto_register = false;
+// Con -w un servidor sin conexiones le pasa el turno al siguiente que tenga pendientes
+bool work_conserving = false;
+// Con -P cada servidor corre en su propio proceso y la memoria compartida sale de shm_arena
+bool process_mode = false;
+char* shm_arena = NULL;
+size_t shm_arena_left = 0;
+// En modo -w el receptor con turno y cola vacía también espera en ready_event a que otro servidor
+// tenga trabajo; shared_mem->ready_waiters le indica a los reactores que deben escribir en él
+int ready_event;
+// Duración del quantum en milisegundos (-q)
+int quantum_ms = DEFAULT_QUANTUM_MS;
+// Plazos en milisegundos (-t) para mandar el encabezado, esperar en la cola y entre lecturas; 0 es sin plazo
+int handshake_timeout_ms = DEFAULT_HANDSHAKE_TIMEOUT_MS;
+int queue_timeout_ms = 0;
+int read_timeout_ms = DEFAULT_READ_TIMEOUT_MS;
+// Plazos de las conexiones de las colas de este proceso. Los vence deadlineThread
+pthread_mutex_t deadline_mutex = PTHREAD_MUTEX_INITIALIZER;
+timer_wheel_t deadline_wheel;
+bool deadlines_started = false;
 
 /*
-    Función para guardar archivo en el directorio del servidor
+    Función que arma la ruta del archivo dentro del directorio del servidor
 */
-void saveFile(const char *server_name, const char *filename, const char *content) {
-    char file_path[256];
+void buildFilePath(const char *server_name, const char *filename, char *file_path, size_t size) {
     char *home_dir = getenv("HOME");
     if (home_dir == NULL) {
         home_dir = "/home";
         printf("Warning: HOME environment variable not set, using %s\n", home_dir);
     }
     
-    snprintf(file_path, sizeof(file_path), "%s/%s/%s", home_dir, server_name, filename);
-    FILE *file = fopen(file_path, "w");
-    if (file) {
-        fprintf(file, "%s", content);
-        fclose(file);
-    }
+    snprintf(file_path, size, "%s/%s/%s", home_dir, server_name, filename);
 }
 
 /*
-    Función para verificar si el tiempo del servidor ha expirado
+    Función que abre el archivo destino en el directorio del servidor. El contenido se va escribiendo
+    conforme llega, así que regresamos el descriptor en vez de recibir el contenido completo
 */
-bool quantumExpired(time_t start_time) {
-    return (time(NULL) - start_time) >= QUANTUM_TIME;
+int openFile(const char *server_name, const char *filename) {
+    char file_path[256];
+    buildFilePath(server_name, filename, file_path, sizeof(file_path));
+    return open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
 }
 
 /*
-    Funcion que agrega una conexión a la cola del servidor correspondiente
+    Función que escribe todo el bloque aunque write lo acepte por partes. Regresa false si el
+    archivo no se pudo escribir
 */
-void addQueue(const char* target_server, int dynamic_client, int dynamic_sock) {
-    connection_node_t* new_node = malloc(sizeof(connection_node_t));
-    new_node->dynamic_client = dynamic_client;
-    new_node->dynamic_sock = dynamic_sock;
-    strncpy(new_node->target_server, target_server, sizeof(new_node->target_server) - 1);
-    new_node->target_server[sizeof(new_node->target_server) - 1] = '\0';
-    new_node->next = NULL;
-    
-    int server_index = -1;
-    for (int i = 0; i < 4; i++) {
-        if (strcmp(target_server, server_names[i]) == 0) {
-            server_index = i;
-            break;
-        }
-    }
-    
-    if (server_index == -1) {
-        free(new_node);
-        return;
-    }
-    
-    pthread_mutex_lock(&queue_mutexes[server_index]);
-    
-    if (connection_queues[server_index] == NULL) {
-        connection_queues[server_index] = new_node;
-    } else {
-        connection_node_t* current = connection_queues[server_index];
-        while (current->next != NULL) {
-            current = current->next;
+bool writeAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error writing file");
+            return false;
         }
-        current->next = new_node;
+        data += written;
+        length -= written;
     }
-    
-    pthread_mutex_unlock(&queue_mutexes[server_index]);
+    return true;
 }
 
 /*
-    Función que obtiene la siguiente conexión de la cola
+    Función que calcula cuándo termina un quantum de quantum milisegundos que empezó en start. Se usa
+    el reloj monotónico para que los cambios de hora no alarguen ni corten el turno
 */
-connection_node_t* getNextConnection(int server_index) {
-    pthread_mutex_lock(&queue_mutexes[server_index]);
-    
-    if (connection_queues[server_index] == NULL) {
-        pthread_mutex_unlock(&queue_mutexes[server_index]);
-        return NULL;
+struct timespec quantumDeadline(const struct timespec* start, int quantum) {
+    struct timespec deadline = *start;
+    deadline.tv_sec += quantum / 1000;
+    deadline.tv_nsec += (long)(quantum % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
     }
-    
-    connection_node_t* node = connection_queues[server_index];
-    connection_queues[server_index] = node->next;
-    
-    pthread_mutex_unlock(&queue_mutexes[server_index]);
-    return node;
+    return deadline;
 }
 
 /*
-    Función que procesa la conexión donde recibe el archivo y lo guarda si es el servidor correcto
+    Función que regresa los milisegundos que faltan para deadline, redondeando hacia arriba para no
+    despertar antes de tiempo, o 0 si ya pasó
 */
-void processConnection(int dynamic_client, int dynamic_sock, const char* target_server) {
-    char buffer[BUFFER_SIZE] = {0};
-    char file_content[BUFFER_SIZE] = {0};
-    char filename[256];
+int remainingMs(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t remaining_ns = (int64_t)(deadline->tv_sec - now.tv_sec) * 1000000000 + (deadline->tv_nsec - now.tv_nsec);
+    return remaining_ns > 0 ? (int)((remaining_ns + 999999) / 1000000) : 0;
+}
 
-    while(1){
-        int bytes = recv(dynamic_client, buffer, sizeof(buffer) - 1, 0);
-        if (bytes <= 0) {
-            break;
-        }else{
-            buffer[bytes] = '\0';
-            
-            char alias[32];
-            if (sscanf(buffer, "%31[^|]|%255[^|]|%[^\n]", alias, filename, file_content) == 3) {
-                if (strcmp(alias, target_server) == 0) {
-                    saveFile(alias, filename, file_content);
-                    char *msg = "File received successfully";
-                    send(dynamic_client, msg, strlen(msg), 0);
-                    printf("[SERVER %s] File %s received\n", alias, filename);
-                } else {
-                    char *msg = "REJECTED - Wrong server";
-                    send(dynamic_client, msg, strlen(msg), 0);
-                    printf("[SERVER %s] Rejected file for %s\n", target_server, alias);
-                }
-            } else {
-                char *msg = "REJECTED";
-                send(dynamic_client, msg, strlen(msg), 0);
-            }
+/*
+    Función para verificar si el tiempo del servidor ha expirado
+*/
+bool quantumExpired(const struct timespec* deadline) {
+    return remainingMs(deadline) == 0;
+}
 
-            memset(buffer, 0, sizeof(buffer));
-            memset(file_content, 0, sizeof(file_content));
-            memset(filename, 0, sizeof(filename));
-        }
-    }
-    
-    close(dynamic_client);
-    close(dynamic_sock);
+double secondsSince(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
 }
 
 /*
-    Función del hilo de cada servidor que espera su turno y procesa las conexiones en su cola usando Round Robin
+    Función que regresa el servidor con ese índice. Los bloques no se mueven, así que no hace falta
+    el candado del registro
 */
-void* serverThread(void* arg) {
-    int server_index = *(int*)arg;
-    free(arg);
-    bool first_waiting_printed = false;
-    
-    //Servidor simpre activo
-    while (1) {
-        
-        pthread_mutex_lock(&shared_mem->mutex);
-        // Los demas servidores esperan su turno
-        while (shared_mem->current_server != server_index || shared_mem->server_busy) {
-            if (!first_waiting_printed) {
-                printf("[SERVER %s] Waiting for turn (current: %s)\n", 
-                       server_names[server_index], server_names[shared_mem->current_server]);
-                first_waiting_printed = true;
-            }
-            pthread_cond_wait(&shared_mem->turn_cond, &shared_mem->mutex);
-        }
-        
-        //Iniciamos el turno del servidor actual y marcamos que está ocupado
-        shared_mem->server_busy = true;
-        shared_mem->receiving_server = server_index;
-        shared_mem->turn_start_time = time(NULL);
-        
-        printf("\n[SERVER %s] Starting turn\n", server_names[server_index]);
+server_t* serverAt(int server_index) {
+    return &registry.chunks[server_index / SERVER_CHUNK][server_index % SERVER_CHUNK];
+}
 
-        //Liberamos el mutex para que otros servidores puedan leer la memoria compartida
-        pthread_mutex_unlock(&shared_mem->mutex);
-        
-        time_t start_time = time(NULL);
-        bool processed_any = false;
-        int files_processed = 0;
-        
-        //Procesamos conexiones hasta que expire el quantum. Nos aseguramos que cada servidor tenga su turno y no se quede esperando indefinidamente.
-        while (!quantumExpired(start_time)) {
-            connection_node_t* connection = getNextConnection(server_index);
-            //Nos aseguramos que el servidor procese las conexiones en su cola, si se le acaba el tiempo y aun hay conexiones, debe esperar su siguiente turno
-            // Si el tiempo se acaba mientras procesa una conexión, la termina y cede el turno
-            if (connection != NULL) {
-                processed_any = true;
-                files_processed++;
-                processConnection(connection->dynamic_client, connection->dynamic_sock, server_names[server_index]);
-                free(connection);
-            } else {
-                if (processed_any) {
-                    time_t remaining = QUANTUM_TIME - (time(NULL) - start_time);
-                    if (remaining > 0) {
-                        sleep(remaining);
-                    }
-                    break;
-                } else {
-                    sleep(1);
-                }
-            }
-        }
-        
-        time_t time_used = time(NULL) - start_time;
+int serverCount(void) {
+    return atomic_load(&registry.count);
+}
 
-        if (!processed_any) {
-            printf("[SERVER %s] Quantum expired with no files to process\n", 
-                   server_names[server_index]);
-        } 
-        
-        //Finalizamos el turno y notificamos a los demas servidores
-        pthread_mutex_lock(&shared_mem->mutex);
-        
-        shared_mem->server_busy = false;
-        shared_mem->receiving_server = -1;
-        shared_mem->current_server = (shared_mem->current_server + 1) % 4;
-        
-        printf("[SERVER %s] Turn finished\n", server_names[server_index]);
-        
-        pthread_cond_broadcast(&shared_mem->turn_cond);
-        pthread_mutex_unlock(&shared_mem->mutex);
-        usleep(1000); 
+/*
+    Función hash FNV-1a del alias
+*/
+uint32_t hashAlias(const char* alias) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)alias; *p != '\0'; p++) {
+        hash = (hash ^ *p) * 16777619u;
     }
-    
-    return NULL;
+    return hash;
 }
 
 /*
-    Funcion que maneja la conexión entrante, lee el alias y encola la conexión en la cola del servidor correspondiente
+    Función que busca el alias en la tabla hash. Regresa la casilla donde está o la casilla vacía
+    donde iría. Se llama con el candado del registro tomado
 */
-void* connectionHand(void* arg) {
-    int* sockets = (int*)arg;
-    int dynamic_client = sockets[0];
-    int dynamic_sock = sockets[1];
-    free(arg);
-    
-    char buffer[BUFFER_SIZE] = {0};
-    
-    int bytes = recv(dynamic_client, buffer, sizeof(buffer) - 1, MSG_PEEK);
-    if (bytes > 0) {
-        buffer[bytes] = '\0';
-        
-        char alias[32];
-        char filename[256];
-        char content[BUFFER_SIZE];
-        
-        if (sscanf(buffer, "%31[^|]|%255[^|]|%[^\n]", alias, filename, content) == 3) {
-            addQueue(alias, dynamic_client, dynamic_sock);
-        } else {
-            close(dynamic_client);
-            close(dynamic_sock);
-        }
-    } else {
-        close(dynamic_client);
-        close(dynamic_sock);
+int registrySlot(const char* alias) {
+    int mask = registry.slot_count - 1;
+    int slot = hashAlias(alias) & mask;
+    while (registry.slots[slot] != 0 && strcmp(serverAt(registry.slots[slot] - 1)->name, alias) != 0) {
+        slot = (slot + 1) & mask;
     }
-    
-    return NULL;
+    return slot;
 }
 
 /*
-    Función que maneja la expiración del quantum y cambia el turno si ningún servidor está ocupado
-    En serverThread cada servidor ya liberan y ceden el turno, así que aquí solo nos aseguramos
-    que si ningún servidor está ocupado y el quantum expiró, y el servidor actual no ha cedido el turno, lo haga.
+    Función que regresa el índice del servidor de ese alias o -1 si no está registrado
 */
-void* quantumAdmin(void* arg) {
-    while (1) {
-        sleep(5);      
-        pthread_mutex_lock(&shared_mem->mutex);
-        
-        //Si el servidor no está recibiendo y el quantum expiró, cambiamos el turno
-        if (!shared_mem->server_busy && quantumExpired(shared_mem->turn_start_time)) {
-            shared_mem->current_server = (shared_mem->current_server + 1) % 4;
-            shared_mem->turn_start_time = time(NULL);
+int findServer(const char* alias) {
+    pthread_rwlock_rdlock(&registry.lock);
+    int index = registry.slots[registrySlot(alias)] - 1;
+    pthread_rwlock_unlock(&registry.lock);
+    return index;
+}
 
-            printf("[*] Switching to server: %s\n", server_names[shared_mem->current_server]);
+/*
+    Función que duplica la tabla hash y vuelve a acomodar los alias. Se llama con el candado de
+    escritura tomado
+*/
+bool registryGrow(void) {
+    int* old_slots = registry.slots;
+    int old_count = registry.slot_count;
+    int* slots = calloc(old_count * 2, sizeof(int));
+    if (slots == NULL) {
+        return false;
+    }
+    registry.slots = slots;
+    registry.slot_count = old_count * 2;
+    for (int i = 0; i < old_count; i++) {
+        if (old_slots[i] != 0) {
+            registry.slots[registrySlot(serverAt(old_slots[i] - 1)->name)] = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return true;
+}
 
-            pthread_cond_broadcast(&shared_mem->turn_cond);
+/*
+    Función que revisa que el alias sirva como nombre de directorio: letras, números, '-', '_' y
+    '.' sin empezar con punto
+*/
+bool validAlias(const char* alias) {
+    size_t len = strlen(alias);
+    if (len == 0 || len > FRAME_MAX_ALIAS || alias[0] == '.') {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)alias[i]) && alias[i] != '-' && alias[i] != '_' && alias[i] != '.') {
+            return false;
         }
-        
-        pthread_mutex_unlock(&shared_mem->mutex);
-        usleep(1000); 
     }
-    return NULL;
+    return true;
 }
 
 /*
-    Función principal que inicializa el servidor, asignar puertos dinámicos a los clientes para recibir archivos y guardarlos en el directorio correspondiente (s01, s02, s03 o s04), 
-    memoria compartida, hilos y espera conexiones entrantes
+    Función que aparta memoria compartida. Con -P sale de la región de shm_open, que ya viene en
+    ceros y se reparte antes de crear los procesos; si no, del heap
 */
-int main(int argc, char *argv[]) {
-    int port_s;
-    int client_port; 
-    struct sockaddr_in server_addr;
-    int port_counter = 1;
+void* sharedAlloc(size_t size) {
+    if (!process_mode) {
+        return calloc(1, size);
+    }
+    size = (size + 63) & ~(size_t)63;
+    if (size > shm_arena_left) {
+        return NULL;
+    }
+    void* memory = shm_arena;
+    shm_arena += size;
+    shm_arena_left -= size;
+    return memory;
+}
 
-    if (argc < 5) { 
-        printf("Use: %s <s01> <s02> <s03> <s04>\n", argv[0]);
-        return 1;
+/*
+    Funciones que toman el mutex compartido, esperan un cambio de turno y lo avisan. Con -P el mutex
+    es robusto: si el proceso que lo tenía murió, el siguiente lo recibe con EOWNERDEAD y lo marca
+    consistente; processMonitor deshace el turno que haya dejado a medias. La espera usa futex sobre
+    turn_seq porque una condición de pthread se puede atorar si muere un proceso que esperaba en ella.
+    Todas se llaman con el mutex tomado, salvo lockShared
+*/
+void lockShared(void) {
+    if (pthread_mutex_lock(&shared_mem->mutex) == EOWNERDEAD) {
+        pthread_mutex_consistent(&shared_mem->mutex);
     }
+}
 
-    for (int i = 0; i < 4; i++) {
-        server_names[i] = argv[i + 1];
-        pthread_mutex_init(&queue_mutexes[i], NULL);
+void waitShared(void) {
+    if (!process_mode) {
+        pthread_cond_wait(&shared_mem->turn_cond, &shared_mem->mutex);
+        return;
     }
+    // Si alguien avisa entre soltar el mutex y dormir, turn_seq ya cambió y futex regresa de inmediato
+    unsigned int seq = atomic_load(&shared_mem->turn_seq);
+    pthread_mutex_unlock(&shared_mem->mutex);
+    syscall(SYS_futex, &shared_mem->turn_seq, FUTEX_WAIT, seq, NULL, NULL, 0);
+    lockShared();
+}
 
-    //Creamos el socket principal para el puerto base
-    port_s = socket(AF_INET, SOCK_STREAM, 0);
-    if (port_s < 0) {
-        perror("[-] Error creating socket");
-        return 1;
+void wakeShared(bool all) {
+    if (!process_mode) {
+        if (all) {
+            pthread_cond_broadcast(&shared_mem->turn_cond);
+        } else {
+            pthread_cond_signal(&shared_mem->turn_cond);
+        }
+        return;
     }
+    atomic_fetch_add(&shared_mem->turn_seq, 1);
+    syscall(SYS_futex, &shared_mem->turn_seq, FUTEX_WAKE, all ? INT_MAX : 1, NULL, NULL, 0);
+}
 
-    int opt = 1;
-    //Permitimos que se vuelva a usar el puerto después de terminar la ejecución del programa
-    if (setsockopt(port_s, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        perror("setsockopt SO_REUSEADDR failed");
-        return 1;
+/*
+    Función que registra un alias y crea su cola y su eventfd. Si ya estaba registrado regresa su
+    índice. Regresa -1 si el registro está lleno o no se pudo crear el eventfd
+*/
+int registerServer(const char* alias, int weight) {
+    pthread_rwlock_wrlock(&registry.lock);
+    int slot = registrySlot(alias);
+    if (registry.slots[slot] != 0) {
+        pthread_rwlock_unlock(&registry.lock);
+        return registry.slots[slot] - 1;
     }
-    //Configuramos la dirección del servidor    
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(server_port);
-    server_addr.sin_addr.s_addr = INADDR_ANY;
 
-    //Asignamos el socket a la dirección y puerto especificados
-    if (bind(port_s, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("[-] Error binding");
-        close(port_s);
-        return 1;
+    int index = atomic_load(&registry.count);
+    if (index >= SERVER_CHUNK * MAX_SERVER_CHUNKS) {
+        pthread_rwlock_unlock(&registry.lock);
+        return -1;
+    }
+    if (registry.chunks[index / SERVER_CHUNK] == NULL) {
+        registry.chunks[index / SERVER_CHUNK] = sharedAlloc(SERVER_CHUNK * sizeof(server_t));
+        if (registry.chunks[index / SERVER_CHUNK] == NULL) {
+            pthread_rwlock_unlock(&registry.lock);
+            return -1;
+        }
     }
 
-    //Escuchamos conexiones entrantes
-    if (listen(port_s, 10) < 0) {
-        perror("[-] Error on listen");
-        close(port_s);
-        return 1;
+    server_t* server = serverAt(index);
+    server->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server->event_fd < 0) {
+        perror("eventfd");
+        pthread_rwlock_unlock(&registry.lock);
+        return -1;
     }
-    
-    printf("[*] Round Robin initialized (quantum: %ds)\n", QUANTUM_TIME);
-    printf("[*] Turn order: %s -> %s -> %s -> %s\n", server_names[0], server_names[1], server_names[2], server_names[3]);
-    printf("[*] LISTENING on port %d...\n\n", server_port);
+    snprintf(server->name, sizeof(server->name), "%s", alias);
+    server->index = index;
+    server->weight = weight;
+    mpscInit(&server->queue);
 
-    shared_mem = mmap(NULL, sizeof(shared_memory_t), PROT_READ | PROT_WRITE, 
-                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-    shared_mem->current_server = 0;
-    shared_mem->receiving_server = -1;
-    shared_mem->server_busy = false;
-    shared_mem->turn_start_time = time(NULL);
-    pthread_mutex_init(&shared_mem->mutex, NULL);
-    pthread_cond_init(&shared_mem->turn_cond, NULL);
+    registry.slots[slot] = index + 1;
+    // El servidor queda completo antes de que los receptores lo vean en count
+    atomic_store(&registry.count, index + 1);
+    if ((index + 1) * 2 > registry.slot_count && !registryGrow()) {
+        perror("[-] Error growing server registry");
+    }
+    pthread_rwlock_unlock(&registry.lock);
+    return index;
+}
 
-    pthread_t serverThreads[4];
-    for (int i = 0; i < 4; i++) {
-        int* server_index = malloc(sizeof(int));
-        *server_index = i;
-        pthread_create(&serverThreads[i], NULL, serverThread, server_index);
-        pthread_detach(serverThreads[i]);
+/*
+    Función que registra un alias que llegó por la red (-A). Crea su directorio si no existe y
+    despierta a un receptor por si estaba esperando servidores libres
+*/
+int registerRemoteServer(const char* alias) {
+    if (!validAlias(alias)) {
+        return -1;
+    }
+    char dir_path[256];
+    buildFilePath(alias, "", dir_path, sizeof(dir_path));
+    if (mkdir(dir_path, 0755) < 0 && errno != EEXIST) {
+        perror("[-] Error creating server directory");
+        return -1;
+    }
+    int server_index = registerServer(alias, 1);
+    if (server_index >= 0) {
+        printf("[*] Registered server %s (%d servers)\n", alias, serverCount());
+        lockShared();
+        wakeShared(false);
+        pthread_mutex_unlock(&shared_mem->mutex);
     }
+    return server_index;
+}
 
-    pthread_t quantum_thread;
-    pthread_create(&quantum_thread, NULL, quantumAdmin, NULL);
-    pthread_detach(quantum_thread);
+/*
+    Función que agrega el servidor al final de la lista ready. Se llama con shared_mem->mutex tomado
+*/
+void readyPush(server_t* server) {
+    atomic_store(&server->ready, true);
+    server->ready_next = NULL;
+    if (shared_mem->ready_tail != NULL) {
+        shared_mem->ready_tail->ready_next = server;
+    } else {
+        shared_mem->ready_head = server;
+    }
+    shared_mem->ready_tail = server;
+    atomic_fetch_add(&shared_mem->ready_count, 1);
+}
 
-    while (1) {
-        struct sockaddr_in client_addr;
-        socklen_t addr_size = sizeof(client_addr);
-        client_port = accept(port_s, (struct sockaddr*)&client_addr, &addr_size);
-        
-        if (client_port < 0) {
-            perror("Accept error");
-            continue;
+/*
+    Función que saca de la lista ready al servidor que sigue de prev (o al primero si prev es NULL)
+    y regresa su índice. Se llama con shared_mem->mutex tomado
+*/
+int readyRemoveAfter(server_t* prev) {
+    server_t* server = prev != NULL ? prev->ready_next : shared_mem->ready_head;
+    if (prev != NULL) {
+        prev->ready_next = server->ready_next;
+    } else {
+        shared_mem->ready_head = server->ready_next;
+    }
+    if (shared_mem->ready_tail == server) {
+        shared_mem->ready_tail = prev;
+    }
+    atomic_store(&server->ready, false);
+    atomic_fetch_sub(&shared_mem->ready_count, 1);
+    return server->index;
+}
+
+/*
+    Función que avisa que el servidor tiene conexiones pendientes (modo -w). Si no tiene turno y no
+    está en la lista ready lo forma al final y despierta a un receptor. Lo normal es que ya esté
+    formado o recibiendo, y entonces no se toma el mutex
+*/
+void markReady(server_t* server) {
+    if (atomic_load(&server->receiving) || atomic_load(&server->ready)) {
+        return;
+    }
+    lockShared();
+    if (!atomic_load(&server->receiving) && !atomic_load(&server->ready)) {
+        readyPush(server);
+        wakeShared(false);
+        if (atomic_load(&shared_mem->ready_waiters) > 0) {
+            uint64_t one = 1;
+            if (write(ready_event, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+                perror("[-] Error waking receiver");
+            }
         }
+    }
+    pthread_mutex_unlock(&shared_mem->mutex);
+}
 
-        // Asignamos un puerto dinámico al cliente mayor al puerto base
-        int dynamic_port = server_port + port_counter;
-        port_counter++;
-        
-        //Enviamos el puerto dinámico al cliente
-        char port_msg[64];
-        snprintf(port_msg, sizeof(port_msg), "DYNAMIC_PORT|%d", dynamic_port);
-        send(client_port, port_msg, strlen(port_msg), 0);
-        close(client_port);
+/*
+    Función que apaga el bit de un puerto dinámico para que se pueda volver a asignar
+*/
+void portRelease(int port) {
+    int bit = port - port_map.first;
+    if (bit < 0 || bit >= port_map.count) {
+        return;
+    }
+    atomic_fetch_and(&port_map.bits[bit / 64], ~((uint64_t)1 << (bit % 64)));
+}
 
-        //Creamos el socket para el puerto dinámico
-        int dynamic_sock = socket(AF_INET, SOCK_STREAM, 0);
-        struct sockaddr_in dynamic_addr;
-        
-        dynamic_addr.sin_family = AF_INET;
-        dynamic_addr.sin_port = htons(dynamic_port);
-        dynamic_addr.sin_addr.s_addr = INADDR_ANY;
-        
-        // Permitimos que se vuelva a usar el puerto después de terminar la ejecución del programa
-        int dyn_opt = 1;
-        if (setsockopt(dynamic_sock, SOL_SOCKET, SO_REUSEADDR, &dyn_opt, sizeof(dyn_opt)) < 0) {
-            perror("setsockopt SO_REUSEADDR failed on dynamic socket");
-            close(dynamic_sock);
-            continue;
-        }
+/*
+    Función que cuenta los puertos dinámicos en uso, para las métricas
+*/
+int portsInUse(void) {
+    int in_use = 0;
+    for (int i = 0; i < (port_map.count + 63) / 64; i++) {
+        in_use += __builtin_popcountll(atomic_load(&port_map.bits[i]));
+    }
+    return in_use;
+}
 
-        // Asignamos el socket a la dirección y puerto especificados
-        if (bind(dynamic_sock, (struct sockaddr*)&dynamic_addr, sizeof(dynamic_addr)) < 0) {
-            perror("Bind error on dynamic port");
-            close(dynamic_sock);
-            continue;
+/*
+    Función que cierra el socket de un puerto dinámico propio y devuelve el puerto al mapa. El puerto
+    se saca del socket, así funciona igual en el proceso de un servidor (-P) que lo recibió por SCM_RIGHTS
+*/
+void closeDynamicSocket(int dynamic_sock) {
+    struct sockaddr_in dynamic_addr;
+    socklen_t addr_len = sizeof(dynamic_addr);
+    int port = getsockname(dynamic_sock, (struct sockaddr*)&dynamic_addr, &addr_len) == 0 ? ntohs(dynamic_addr.sin_port) : -1;
+    close(dynamic_sock);
+    portRelease(port);
+}
+
+/*
+    Función que cierra la conexión del cliente y su socket dinámico. En modo INLINE no hay
+    socket dinámico y dynamic_sock vale -1
+*/
+void closeConnection(int dynamic_client, int dynamic_sock) {
+    close(dynamic_client);
+    if (dynamic_sock >= 0) {
+        closeDynamicSocket(dynamic_sock);
+    }
+}
+
+/*
+    Función que regresa el tick de la rueda en que vence un plazo de timeout_ms que empieza ahora.
+    Se redondea hacia arriba para no cortar antes de tiempo
+*/
+uint64_t deadlineTick(int timeout_ms) {
+    return timerTicks(TIMER_TICK_MS) + (timeout_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS + 1;
+}
+
+/*
+    Función que arma el plazo de espera en la cola (-t). Se llama antes de formar la conexión,
+    porque en cuanto está en la cola un receptor la puede sacar
+*/
+void deadlineQueue(connection_node_t* connection) {
+    timerNodeInit(&connection->timer);
+    connection->state = CONNECTION_QUEUED;
+    if (!deadlines_started || queue_timeout_ms == 0) {
+        return;
+    }
+    pthread_mutex_lock(&deadline_mutex);
+    timerWheelAdd(&deadline_wheel, &connection->timer, deadlineTick(queue_timeout_ms));
+    pthread_mutex_unlock(&deadline_mutex);
+}
+
+/*
+    Función que cancela el plazo de la cola cuando el receptor saca la conexión. Regresa false si
+    ya había vencido; en ese caso sus descriptores ya se cerraron y solo queda liberar el nodo
+*/
+bool deadlineClaim(connection_node_t* connection) {
+    if (!deadlines_started || queue_timeout_ms == 0) {
+        connection->state = CONNECTION_SERVING;
+        return true;
+    }
+    pthread_mutex_lock(&deadline_mutex);
+    bool live = connection->state != CONNECTION_EXPIRED;
+    timerWheelCancel(&deadline_wheel, &connection->timer);
+    if (live) {
+        connection->state = CONNECTION_SERVING;
+    }
+    pthread_mutex_unlock(&deadline_mutex);
+    return live;
+}
+
+/*
+    Función que arma el plazo entre lecturas mientras se atiende la conexión. recv no lo renueva:
+    al vencer se revisa en TCP_INFO cuándo llegaron datos por última vez, así recibir no cuesta nada extra
+*/
+void deadlineWatchReads(connection_node_t* connection) {
+    if (!deadlines_started || read_timeout_ms == 0) {
+        return;
+    }
+    pthread_mutex_lock(&deadline_mutex);
+    timerWheelAdd(&deadline_wheel, &connection->timer, deadlineTick(read_timeout_ms));
+    pthread_mutex_unlock(&deadline_mutex);
+}
+
+/*
+    Función que quita el plazo de lectura. Se llama antes de cerrar los descriptores, para que el
+    hilo de plazos nunca toque un descriptor que ya se reutilizó
+*/
+void deadlineDone(connection_node_t* connection) {
+    if (!deadlines_started || read_timeout_ms == 0) {
+        return;
+    }
+    pthread_mutex_lock(&deadline_mutex);
+    timerWheelCancel(&deadline_wheel, &connection->timer);
+    pthread_mutex_unlock(&deadline_mutex);
+}
+
+/*
+    Función que atiende un plazo vencido con deadline_mutex tomado. Una conexión formada se cierra y
+    queda en la cola hasta que su receptor la saque. A una que se está atendiendo se le da el tiempo
+    que le falta si recibió datos hace poco; si no, shutdown despierta al recv, splice o io_uring
+    que la espera y quien la atiende la termina como si el cliente se hubiera desconectado
+*/
+void deadlineExpire(timer_node_t* timer) {
+    connection_node_t* connection = timerEntry(timer, connection_node_t, timer);
+    if (connection->state == CONNECTION_QUEUED) {
+        closeConnection(connection->dynamic_client, connection->dynamic_sock);
+        connection->state = CONNECTION_EXPIRED;
+        atomic_fetch_add(&shared_mem->queue_timeouts, 1);
+        printf("[-] Connection for server %s timed out in the queue\n", connection->target_server);
+        return;
+    }
+
+    struct tcp_info info;
+    socklen_t info_len = sizeof(info);
+    if (getsockopt(connection->dynamic_client, IPPROTO_TCP, TCP_INFO, &info, &info_len) == 0 &&
+        info.tcpi_last_data_recv < (unsigned)read_timeout_ms) {
+        timerWheelAdd(&deadline_wheel, timer, deadlineTick(read_timeout_ms - info.tcpi_last_data_recv));
+        return;
+    }
+    shutdown(connection->dynamic_client, SHUT_RDWR);
+    atomic_fetch_add(&shared_mem->read_timeouts, 1);
+    printf("[-] Connection for server %s timed out waiting for data\n", connection->target_server);
+}
+
+/*
+    Hilo que avanza la rueda de plazos de las colas cada TIMER_TICK_MS. Cada tick solo revisa la
+    ranura que le toca, así que su costo no depende de cuántas conexiones haya
+*/
+void* deadlineThread(void* arg) {
+    (void)arg;
+    struct timespec tick = {.tv_sec = 0, .tv_nsec = TIMER_TICK_MS * 1000000L};
+    while (1) {
+        nanosleep(&tick, NULL);
+        pthread_mutex_lock(&deadline_mutex);
+        timer_node_t* expired = timerWheelAdvance(&deadline_wheel, timerTicks(TIMER_TICK_MS));
+        while (expired != NULL) {
+            timer_node_t* next = expired->prev;
+            deadlineExpire(expired);
+            expired = next;
         }
-        
-        // Escuchamos conexiones entrantes
-        if (listen(dynamic_sock, 1) < 0) {
-            perror("Listen error on dynamic port");
-            close(dynamic_sock);
+        pthread_mutex_unlock(&deadline_mutex);
+    }
+    return NULL;
+}
+
+/*
+    Función que arranca el hilo de plazos de las colas si hay plazo de cola o de lectura. Con -P
+    cada proceso de servidor tiene el suyo
+*/
+bool deadlinesStart(void) {
+    if (queue_timeout_ms == 0 && read_timeout_ms == 0) {
+        return true;
+    }
+    timerWheelInit(&deadline_wheel, timerTicks(TIMER_TICK_MS));
+    deadlines_started = true;
+    pthread_t deadline_thread;
+    if (pthread_create(&deadline_thread, NULL, deadlineThread, NULL) != 0) {
+        deadlines_started = false;
+        return false;
+    }
+    pthread_detach(deadline_thread);
+    return true;
+}
+
+/*
+    Función que forma la conexión en la cola del servidor y despierta a su receptor. enqueued es
+    cuando el acceptor la entregó
+*/
+void enqueueConnection(server_t* server, int dynamic_client, int dynamic_sock, const struct timespec* enqueued) {
+    connection_node_t* new_node = malloc(sizeof(connection_node_t));
+    new_node->dynamic_client = dynamic_client;
+    new_node->dynamic_sock = dynamic_sock;
+    snprintf(new_node->target_server, sizeof(new_node->target_server), "%s", server->name);
+    new_node->enqueued = *enqueued;
+    deadlineQueue(new_node);
+
+    mpscPush(&server->queue, &new_node->link);
+    atomic_fetch_add(&server->pending, 1);
+    if (atomic_load(&server->waiting) > 0) {
+        uint64_t one = 1;
+        if (write(server->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            perror("[-] Error waking server thread");
+        }
+    }
+    if (work_conserving) {
+        markReady(server);
+    }
+}
+
+/*
+    Función que le pasa la conexión al proceso del servidor (-P) con SCM_RIGHTS junto con la hora en
+    que se entregó. Si se envió, los descriptores de este proceso ya no hacen falta y se cierran
+*/
+bool sendConnection(server_t* server, int dynamic_client, int dynamic_sock, const struct timespec* enqueued) {
+    int fds[2] = {dynamic_client, dynamic_sock};
+    int fd_count = dynamic_sock >= 0 ? 2 : 1;
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = {.iov_base = (void*)enqueued, .iov_len = sizeof(*enqueued)};
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = CMSG_SPACE(fd_count * sizeof(int)),
+    };
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(int));
+
+    while (sendmsg(server->channel[0], &msg, MSG_NOSIGNAL) < 0) {
+        if (errno != EINTR) {
+            perror("[-] Error passing connection to server process");
+            return false;
+        }
+    }
+    // El puerto sigue en uso hasta que el proceso del servidor cierre su copia
+    close(dynamic_client);
+    if (dynamic_sock >= 0) {
+        close(dynamic_sock);
+    }
+    return true;
+}
+
+/*
+    Función que arma la respuesta a un mensaje. Si el frame pidió confirmación la respuesta es una
+    línea ACK|seq|mensaje para que el cliente sepa a qué archivo corresponde, si no va el mensaje solo
+*/
+size_t buildReply(char* reply, size_t size, const frame_t* frame, const char* msg) {
+    if (frame->binary && (frame->flags & FRAME_FLAG_ACK)) {
+        return ackFormat(reply, size, frame->seq, msg);
+    }
+    snprintf(reply, size, "%s", msg);
+    return strlen(reply);
+}
+
+/*
+    Función que revisa si todavía caben conexiones en total (-L). Los reactores la usan antes de
+    asignar un puerto dinámico
+*/
+bool admissionOpen(void) {
+    return total_limit == 0 || atomic_load(&shared_mem->admitted) < total_limit;
+}
+
+/*
+    Función que aparta un lugar para la conexión en la cola del servidor (-l) y en el total (-L).
+    Regresa false si alguno de los dos ya está lleno. El lugar se libera cuando un receptor toma
+    la conexión
+*/
+bool admitConnection(server_t* server) {
+    int total = atomic_fetch_add(&shared_mem->admitted, 1);
+    int queued = atomic_fetch_add(&server->admitted, 1);
+    if ((total_limit > 0 && total >= total_limit) || (queue_limit > 0 && queued >= queue_limit)) {
+        atomic_fetch_sub(&server->admitted, 1);
+        atomic_fetch_sub(&shared_mem->admitted, 1);
+        return false;
+    }
+    return true;
+}
+
+void admissionRelease(server_t* server, int count) {
+    atomic_fetch_sub(&server->admitted, count);
+    atomic_fetch_sub(&shared_mem->admitted, count);
+}
+
+/*
+    Función que estima en cuántos milisegundos se libera un lugar: las conexiones formadas por lo
+    que tarda en promedio una conexión, repartidas entre quienes las atienden a la vez. Con server
+    en NULL la estimación es sobre el total
+*/
+int retryAfterMs(server_t* server) {
+    uint64_t served = atomic_load(&shared_mem->served);
+    double avg_ms = served > 0 ? atomic_load(&shared_mem->served_us) / 1000.0 / served : BUSY_MIN_RETRY_MS;
+    int backlog = atomic_load(&shared_mem->admitted);
+    int workers = shared_mem->max_receivers * handler_count;
+    if (server != NULL) {
+        // A un servidor lo atiende un solo receptor a la vez
+        served = atomic_load(&server->served);
+        if (served > 0) {
+            avg_ms = atomic_load(&server->served_us) / 1000.0 / served;
+        }
+        backlog = atomic_load(&server->admitted);
+        workers = handler_count;
+    }
+    double retry_ms = backlog * avg_ms / workers;
+    if (retry_ms < BUSY_MIN_RETRY_MS) {
+        return BUSY_MIN_RETRY_MS;
+    }
+    return retry_ms > BUSY_MAX_RETRY_MS ? BUSY_MAX_RETRY_MS : (int)retry_ms;
+}
+
+/*
+    Función que le responde BUSY|ms a un cliente que no cabe. Si ya mandó un frame que pide
+    confirmación la respuesta va como su ACK. shutdown manda el fin de la respuesta antes de que
+    quien llama cierre, porque el cliente puede seguir enviando el archivo y el cierre lo corta
+*/
+void sendBusy(server_t* server, const frame_t* frame, int client_sock) {
+    char msg[32];
+    char reply[64];
+    busyFormat(msg, sizeof(msg), retryAfterMs(server));
+    size_t reply_len = frame != NULL ? buildReply(reply, sizeof(reply), frame, msg) : (size_t)snprintf(reply, sizeof(reply), "%s", msg);
+    send(client_sock, reply, reply_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    shutdown(client_sock, SHUT_WR);
+    atomic_fetch_add(server != NULL ? &server->busy_replies : &shared_mem->busy_replies, 1);
+}
+
+/*
+    Funcion que agrega una conexión a la cola del servidor correspondiente. Con -P la conexión se
+    le pasa a su proceso, que es quien la forma en la cola. Si la cola está llena le responde BUSY
+    al cliente. Regresa false si la conexión no se formó y quien llama la debe cerrar
+*/
+bool addQueue(const frame_t* frame, int dynamic_client, int dynamic_sock) {
+    char target_server[FRAME_MAX_ALIAS + 1];
+    snprintf(target_server, sizeof(target_server), "%.*s", (int)frame->alias_len, frame->alias);
+    int server_index = findServer(target_server);
+    if (server_index < 0 && auto_register) {
+        server_index = registerRemoteServer(target_server);
+    }
+    if (server_index < 0) {
+        return false;
+    }
+
+    server_t* server = serverAt(server_index);
+    if (!admitConnection(server)) {
+        sendBusy(server, frame, dynamic_client);
+        return false;
+    }
+    struct timespec enqueued;
+    clock_gettime(CLOCK_MONOTONIC, &enqueued);
+    if (process_mode) {
+        if (!sendConnection(server, dynamic_client, dynamic_sock, &enqueued)) {
+            admissionRelease(server, 1);
+            return false;
+        }
+        return true;
+    }
+    enqueueConnection(server, dynamic_client, dynamic_sock, &enqueued);
+    return true;
+}
+
+/*
+    Función que obtiene la siguiente conexión de la cola. Solo la llama el receptor con el turno del
+    servidor. Las conexiones que vencieron en la cola ya están cerradas y solo se liberan
+*/
+connection_node_t* getNextConnection(server_t* server) {
+    connection_node_t* connection;
+    while ((connection = (connection_node_t*)mpscPop(&server->queue)) != NULL) {
+        atomic_fetch_sub(&server->pending, 1);
+        admissionRelease(server, 1);
+        if (deadlineClaim(connection)) {
+            break;
+        }
+        free(connection);
+    }
+    return connection;
+}
+
+/*
+    Función que lee un eventfd para rearmarlo después de que poll lo marcó
+*/
+void drainEvent(int event_fd) {
+    uint64_t count;
+    if (read(event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("[-] Error reading queue event");
+    }
+}
+
+/*
+    Función que espera hasta timeout_ms a que llegue una conexión a la cola del servidor. Regresa
+    NULL si se acabó el tiempo. Después de marcar waiting revisamos la cola otra vez, porque
+    un reactor que encoló antes de ver la marca no escribe en el eventfd
+*/
+connection_node_t* waitNextConnection(server_t* server, int timeout_ms) {
+    connection_node_t* connection = getNextConnection(server);
+    if (connection != NULL || timeout_ms <= 0) {
+        return connection;
+    }
+
+    atomic_fetch_add(&server->waiting, 1);
+    connection = getNextConnection(server);
+    if (connection == NULL) {
+        struct pollfd event = {.fd = server->event_fd, .events = POLLIN};
+        if (poll(&event, 1, timeout_ms) > 0) {
+            drainEvent(server->event_fd);
+        }
+        connection = getNextConnection(server);
+    }
+    atomic_fetch_sub(&server->waiting, 1);
+    return connection;
+}
+
+/*
+    Función que espera hasta timeout_ms a que llegue una conexión a la cola del servidor o a que
+    otro servidor tenga trabajo. La usa el receptor con turno en modo -w cuando nadie tiene trabajo.
+    Solo se vigilan dos eventfd sin importar cuántos servidores haya
+*/
+void waitAnyConnection(server_t* server, int timeout_ms) {
+    atomic_fetch_add(&server->waiting, 1);
+    atomic_fetch_add(&shared_mem->ready_waiters, 1);
+    // Igual que en waitNextConnection, revisamos después de marcar para no perder un aviso
+    if (atomic_load(&server->pending) == 0 && atomic_load(&shared_mem->ready_count) == 0) {
+        struct pollfd events[2] = {
+            {.fd = server->event_fd, .events = POLLIN},
+            {.fd = ready_event, .events = POLLIN},
+        };
+        if (poll(events, 2, timeout_ms) > 0) {
+            for (int i = 0; i < 2; i++) {
+                if (events[i].revents & POLLIN) {
+                    drainEvent(events[i].fd);
+                }
+            }
+        }
+    }
+    atomic_fetch_sub(&shared_mem->ready_waiters, 1);
+    atomic_fetch_sub(&server->waiting, 1);
+}
+
+/*
+    Round Robin: todos los servidores tienen el mismo quantum y el turno pasa al siguiente que no
+    tenga turno (con -k puede haber otros recibiendo, a lo más k saltos). Con -w el turno pasa al
+    primero de la lista ready, que tiene a los servidores con conexiones pendientes en el orden en
+    que les llegó trabajo
+*/
+int roundRobinNext(int server_index) {
+    if (work_conserving) {
+        return shared_mem->ready_head != NULL ? readyRemoveAfter(NULL) : -1;
+    }
+    int count = serverCount();
+    for (int i = 1; i <= count; i++) {
+        int candidate = (server_index + i) % count;
+        if (!atomic_load(&serverAt(candidate)->receiving)) {
+            return candidate;
+        }
+    }
+    return -1;
+}
+
+int fixedQuantum(int server_index) {
+    (void)server_index;
+    return quantum_ms;
+}
+
+/*
+    Round Robin con pesos: el quantum de cada servidor es el de -q por su peso (-W)
+*/
+int weightedQuantum(int server_index) {
+    return quantum_ms * serverAt(server_index)->weight;
+}
+
+/*
+    Deficit Round Robin por bytes: cada turno suma DRR_QUANTUM_BYTES por el peso al crédito del
+    servidor y cada conexión atendida resta lo que recibió. El servidor atiende mientras tenga crédito;
+    si se pasa, la deuda se descuenta en su siguiente turno. Un servidor sin conexiones pendientes
+    no acumula crédito. El quantum de tiempo sigue como límite
+*/
+void deficitTurnStart(int server_index) {
+    server_t* server = serverAt(server_index);
+    atomic_fetch_add(&server->deficit, (long long)DRR_QUANTUM_BYTES * server->weight);
+}
+
+bool deficitMayContinue(int server_index) {
+    return atomic_load(&serverAt(server_index)->deficit) > 0;
+}
+
+void deficitConnectionDone(int server_index, uint64_t bytes) {
+    atomic_fetch_sub(&serverAt(server_index)->deficit, (long long)bytes);
+}
+
+void deficitTurnEnd(int server_index) {
+    server_t* server = serverAt(server_index);
+    if (atomic_load(&server->pending) == 0 && atomic_load(&server->deficit) > 0) {
+        atomic_store(&server->deficit, 0);
+    }
+}
+
+/*
+    Cola más corta primero: el turno pasa al servidor de la lista ready con menos conexiones
+    pendientes, así los servidores con poca carga esperan poco. Es la única política que recorre la
+    lista, así que cuesta O(servidores con trabajo) por cambio de turno. Un servidor con mucha carga
+    puede esperar varias vueltas mientras sigan llegando colas más cortas
+*/
+int shortestQueueNext(int server_index) {
+    (void)server_index;
+    server_t* best_prev = NULL;
+    server_t* best = NULL;
+    int best_pending = 0;
+    server_t* prev = NULL;
+    for (server_t* candidate = shared_mem->ready_head; candidate != NULL; candidate = candidate->ready_next) {
+        int pending = atomic_load(&candidate->pending);
+        if (best == NULL || pending < best_pending) {
+            best_prev = prev;
+            best = candidate;
+            best_pending = pending;
+        }
+        prev = candidate;
+    }
+    return best != NULL ? readyRemoveAfter(best_prev) : -1;
+}
+
+const sched_policy_t sched_policies[] = {
+    {"rr", fixedQuantum, NULL, NULL, NULL, NULL, roundRobinNext},
+    {"wrr", weightedQuantum, NULL, NULL, NULL, NULL, roundRobinNext},
+    {"drr", fixedQuantum, deficitTurnStart, deficitMayContinue, deficitConnectionDone, deficitTurnEnd, roundRobinNext},
+    {"sqf", fixedQuantum, NULL, NULL, NULL, NULL, shortestQueueNext},
+};
+
+const sched_policy_t* findPolicy(const char* name) {
+    for (size_t i = 0; i < sizeof(sched_policies) / sizeof(sched_policies[0]); i++) {
+        if (strcmp(sched_policies[i].name, name) == 0) {
+            return &sched_policies[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+    Función que imprime las métricas de la política: conexiones, MB y espera en cola de cada
+    servidor, el rendimiento total y el índice de equidad de Jain sobre los bytes por peso de los
+    servidores que recibieron algo (1 es reparto perfecto)
+*/
+void printMetrics(void) {
+    const sched_policy_t* policy = shared_mem->policy;
+    double elapsed = secondsSince(&shared_mem->started);
+    uint64_t total_connections = 0;
+    uint64_t total_bytes = 0;
+    double share_sum = 0;
+    double share_squares = 0;
+    int active = 0;
+    int count = serverCount();
+
+    printf("\n[*] Scheduler metrics (%s, %d servers, %.1f s)\n", policy->name, count, elapsed);
+    for (int i = 0; i < count; i++) {
+        server_t* server = serverAt(i);
+        sched_metrics_t* m = &server->metrics;
+        double avg_wait = m->connections > 0 ? m->wait_seconds / m->connections : 0;
+        printf("[*]   %s (weight %d): %lu connections, %.1f MB, %lu turns, held %.2f s, busy %.2f s, wait avg %.1f ms max %.1f ms, %lu BUSY\n",
+               server->name, server->weight, (unsigned long)m->connections, m->bytes / 1e6, (unsigned long)m->turns,
+               m->held_seconds, m->busy_seconds, avg_wait * 1000, m->max_wait_seconds * 1000,
+               atomic_load(&server->busy_replies));
+        total_connections += m->connections;
+        total_bytes += m->bytes;
+        if (m->bytes > 0) {
+            double share = (double)m->bytes / server->weight;
+            share_sum += share;
+            share_squares += share * share;
+            active++;
+        }
+    }
+    printf("[*]   throughput %.1f connections/s, %.1f MB/s\n", total_connections / elapsed, total_bytes / 1e6 / elapsed);
+    if (queue_limit > 0 || total_limit > 0) {
+        printf("[*]   %lu clients sent BUSY before getting a port\n", atomic_load(&shared_mem->busy_replies));
+    }
+    printf("[*]   timeouts: %lu handshake, %lu queue, %lu read\n", atomic_load(&shared_mem->handshake_timeouts),
+           atomic_load(&shared_mem->queue_timeouts), atomic_load(&shared_mem->read_timeouts));
+    printf("[*]   dynamic ports: %d in use, %lu busy ports skipped, %lu clients without a port\n", portsInUse(),
+           atomic_load(&shared_mem->ports_skipped), atomic_load(&shared_mem->ports_exhausted));
+    if (active > 0) {
+        printf("[*]   fairness (Jain, bytes per weight) %.3f over %d servers\n",
+               share_sum * share_sum / (active * share_squares), active);
+    }
+    fflush(stdout);
+}
+
+/*
+    Hilo que espera SIGINT o SIGTERM para imprimir las métricas antes de terminar. Las señales se
+    bloquean en los demás hilos desde main
+*/
+void* metricsThread(void* arg) {
+    sigset_t* signals = (sigset_t*)arg;
+    int signal_number;
+    sigwait(signals, &signal_number);
+    printMetrics();
+    exit(0);
+    return NULL;
+}
+
+/*
+    Función que revisa si en el buffer ya se puede atender el siguiente mensaje. De un frame basta con
+    el encabezado y los nombres porque el contenido se guarda por bloques. El formato alias|archivo|contenido
+    no trae longitud, así que igual que antes cada recv se toma como un mensaje entero
+*/
+frame_status_t nextMessage(const char* buffer, size_t length, frame_t* frame) {
+    frame_status_t status = protocolParseHead(buffer, length, frame);
+    if (status == FRAME_INCOMPLETE && length > 0 && !frame->binary) {
+        return FRAME_INVALID;
+    }
+    return status;
+}
+
+/*
+    Función que pasa al archivo lo que quedó en el pipe cuando el archivo no acepta splice. Regresa
+    false si el archivo no se pudo escribir
+*/
+bool drainPipe(int pipe_fd, int file_fd, size_t length) {
+    char chunk[4096];
+    while (length > 0) {
+        ssize_t bytes = read(pipe_fd, chunk, length < sizeof(chunk) ? length : sizeof(chunk));
+        if (bytes < 0 && errno == EINTR) {
             continue;
         }
-        
-        printf("[*] Assigned dynamic port %d to client\n", dynamic_port);
+        if (bytes <= 0) {
+            return false;
+        }
+        if (!writeAll(file_fd, chunk, bytes)) {
+            return false;
+        }
+        length -= bytes;
+    }
+    return true;
+}
 
-        // Aceptamos la conexión del cliente en el puerto dinámico
-        int dynamic_client = accept(dynamic_sock, NULL, NULL);
-        if (dynamic_client < 0) {
-            perror("Accept error on dynamic port");
-            close(dynamic_sock);
+/*
+    Función que mueve el contenido del socket al archivo con splice a través de un pipe, así los
+    bytes nunca se copian al proceso. Regresa 0 si terminó, -1 si el cliente se desconectó, 1 si el
+    archivo no acepta splice y 2 si el archivo no se pudo escribir; en esos dos casos remaining dice
+    cuánto falta por recibir
+*/
+int splicePayload(int dynamic_client, int file_fd, uint64_t* remaining) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) < 0) {
+        return 1;
+    }
+    fcntl(pipe_fds[1], F_SETPIPE_SZ, FRAME_CHUNK_SIZE);
+
+    int result = 0;
+    while (*remaining > 0 && result == 0) {
+        size_t want = *remaining < FRAME_CHUNK_SIZE ? *remaining : FRAME_CHUNK_SIZE;
+        ssize_t in = splice(dynamic_client, NULL, pipe_fds[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in < 0 && errno == EINTR) {
             continue;
         }
+        if (in <= 0) {
+            result = -1;
+            break;
+        }
+        *remaining -= in;
 
-        int* sockets = malloc(2 * sizeof(int));
-        sockets[0] = dynamic_client;
-        sockets[1] = dynamic_sock;
-        
-        pthread_t handler_thread;
-        pthread_create(&handler_thread, NULL, connectionHand, sockets);
-        pthread_detach(handler_thread);
-        usleep(1000); 
+        size_t left = in;
+        while (left > 0) {
+            ssize_t out = splice(pipe_fds[0], NULL, file_fd, NULL, left, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out < 0 && errno == EINTR) {
+                continue;
+            }
+            if (out <= 0) {
+                // Lo que ya está en el pipe se guarda a mano y el resto sigue por el buffer
+                result = drainPipe(pipe_fds[0], file_fd, left) ? 1 : 2;
+                break;
+            }
+            left -= out;
+        }
     }
-    
-    close(port_s);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return result;
+}
+
+/*
+    Función que pasa el contenido de un mensaje del socket al archivo. Lo que llegó junto con el
+    encabezado se escribe primero y el resto se mueve con splice o se recibe por bloques del tamaño
+    del buffer, así la memoria por conexión no depende del tamaño del archivo. Con file_fd en -1 el contenido solo se
+    descarta, y lo mismo pasa con el resto si una escritura falla. saved dice si el contenido quedó
+    completo en el archivo. Regresa lo que quedó en el buffer después del mensaje, o -1 si el cliente se desconectó
+*/
+ssize_t streamPayload(int dynamic_client, int file_fd, char* buffer, size_t length, size_t capacity, const frame_t* frame,
+                      bool* saved) {
+    size_t available = length - frame->head_len;
+    size_t now = available < frame->payload_len ? available : frame->payload_len;
+    uint64_t remaining = frame->payload_len - now;
+    if (file_fd >= 0 && !writeAll(file_fd, frame->payload, now)) {
+        file_fd = -1;
+    }
+    *saved = file_fd >= 0;
+
+    if (remaining == 0) {
+        size_t used = frame->frame_len;
+        memmove(buffer, buffer + used, length - used);
+        return length - used;
+    }
+
+    // El contenido no necesita cambios, así que de aquí en adelante puede ir directo al archivo
+    if (file_fd >= 0 && recv_path == RECV_SPLICE) {
+        int result = splicePayload(dynamic_client, file_fd, &remaining);
+        if (result < 0) {
+            return -1;
+        }
+        if (result == 2) {
+            file_fd = -1;
+            *saved = false;
+        }
+    }
+
+    // Ya se usó todo el buffer, pedimos solo lo que falta del contenido para no mezclar mensajes
+    while (remaining > 0) {
+        size_t want = remaining < capacity ? remaining : capacity;
+        int bytes = recv(dynamic_client, buffer, want, 0);
+        if (bytes <= 0) {
+            return -1;
+        }
+        if (file_fd >= 0 && !writeAll(file_fd, buffer, bytes)) {
+            file_fd = -1;
+            *saved = false;
+        }
+        remaining -= bytes;
+    }
+    return 0;
+}
+
+/*
+    Función que procesa la conexión donde recibe el archivo y lo guarda si es el servidor correcto.
+    Un cliente puede mandar varios frames sin esperar; se atienden en orden y cada uno recibe su
+    confirmación. Regresa los bytes de contenido que se guardaron, para la política de turnos
+*/
+uint64_t processConnection(int dynamic_client, const char* target_server) {
+    char buffer[FRAME_MAX_HEAD + FRAME_CHUNK_SIZE];
+    size_t length = 0;
+    uint64_t received = 0;
+
+    while(1){
+        frame_t frame;
+        frame_status_t status = nextMessage(buffer, length, &frame);
+        if (status == FRAME_INCOMPLETE) {
+            int bytes = recv(dynamic_client, buffer + length, sizeof(buffer) - length, 0);
+            if (bytes <= 0) {
+                break;
+            }
+            length += bytes;
+            continue;
+        }
+
+        if (status == FRAME_INVALID) {
+            char *msg = "REJECTED";
+            send(dynamic_client, msg, strlen(msg), 0);
+            length = 0;
+            continue;
+        }
+
+        char alias[FRAME_MAX_ALIAS + 1];
+        char filename[FRAME_MAX_NAME + 1];
+        snprintf(alias, sizeof(alias), "%.*s", (int)frame.alias_len, frame.alias);
+        snprintf(filename, sizeof(filename), "%.*s", (int)frame.name_len, frame.filename);
+
+        // Si el archivo no es para este servidor igual hay que leer su contenido para llegar al siguiente mensaje
+        bool accepted = strcmp(alias, target_server) == 0;
+        int file_fd = accepted ? openFile(alias, filename) : -1;
+        if (accepted && file_fd < 0) {
+            perror("Error opening file");
+        }
+        bool saved;
+        ssize_t rest = streamPayload(dynamic_client, file_fd, buffer, length, sizeof(buffer), &frame, &saved);
+        if (file_fd >= 0 && close(file_fd) < 0) {
+            perror("Error closing file");
+            saved = false;
+        }
+        if (rest < 0) {
+            break;
+        }
+        length = rest;
+
+        char *msg;
+        if (accepted && saved) {
+            received += frame.payload_len;
+            msg = "File received successfully";
+            printf("[SERVER %s] File %s received\n", alias, filename);
+        } else if (accepted) {
+            // El contenido ya se leyó completo, así que la conexión puede seguir con el siguiente archivo
+            msg = SAVE_ERROR_MSG;
+            printf("[SERVER %s] Could not save file %s\n", alias, filename);
+        } else {
+            msg = "REJECTED - Wrong server";
+            printf("[SERVER %s] Rejected file for %s\n", target_server, alias);
+        }
+
+        // Si el siguiente frame ya llegó completo, la confirmación espera para salir junto con la suya
+        frame_t pending;
+        int more = protocolParse(buffer, length, &pending) == FRAME_READY ? MSG_MORE : 0;
+        char reply[BUFFER_SIZE];
+        size_t reply_len = buildReply(reply, sizeof(reply), &frame, msg);
+        send(dynamic_client, reply, reply_len, more);
+    }
+    return received;
+}
+
+/*
+    Función que espera las completadas de un lote. results[tag] recibe el resultado de la operación
+    marcada con tag, para las marcas menores a tags. Regresa false si el anillo falló
+*/
+bool uringWaitResults(uring_t* ring, unsigned count, int* results, unsigned tags) {
+    for (unsigned i = 0; i < tags; i++) {
+        results[i] = -1;
+    }
+    if (uringSubmit(ring, count) < 0) {
+        return false;
+    }
+    unsigned seen = 0;
+    while (seen < count) {
+        struct io_uring_cqe* cqe = uringPeekCqe(ring);
+        if (cqe == NULL) {
+            if (uringSubmit(ring, count - seen) < 0) {
+                return false;
+            }
+            continue;
+        }
+        if (cqe->user_data < tags) {
+            results[cqe->user_data] = cqe->res;
+        }
+        uringCqeSeen(ring);
+        seen++;
+    }
+    return true;
+}
+
+/*
+    Función que espera las completadas de un lote y regresa el resultado de la operación
+    marcada con result_tag, o -1 si el anillo falló
+*/
+int uringWaitBatch(uring_t* ring, unsigned count, uint64_t result_tag) {
+    int results[5];
+    if (!uringWaitResults(ring, count, results, 5) || result_tag >= 5) {
+        return -1;
+    }
+    return results[result_tag];
+}
+
+/*
+    Función que revisa la escritura de un bloque al archivo. res es lo que regresó el kernel; si solo
+    aceptó una parte, lo que falta se escribe en escrituras nuevas. Regresa false si el archivo no se
+    pudo escribir
+*/
+bool uringFinishWrite(uring_t* ring, int file_fd, const char* data, size_t length, uint64_t offset, int res) {
+    while (res > 0 && (size_t)res < length) {
+        data += res;
+        length -= res;
+        offset += res;
+        struct io_uring_sqe* sqe = uringGetSqe(ring);
+        if (sqe == NULL) {
+            res = -EIO;
+            break;
+        }
+        uringPrepWrite(sqe, file_fd, data, length, offset, 2);
+        res = uringWaitBatch(ring, 1, 2);
+    }
+    if (res > 0 && (size_t)res == length) {
+        return true;
+    }
+    errno = res < 0 ? -res : EIO;
+    perror("Error writing file");
+    return false;
+}
+
+/*
+    Versión io_uring de streamPayload. Usa dos bloques: mientras el kernel escribe uno en el archivo
+    ya está recibiendo el siguiente en el otro, y las dos operaciones salen en el mismo lote. Igual que
+    en streamPayload, si una escritura falla el resto del contenido solo se descarta y saved queda en false
+*/
+ssize_t streamPayloadUring(uring_t* ring, int dynamic_client, int file_fd, char* buffer, char* spare,
+                           size_t length, size_t capacity, const frame_t* frame, bool* saved) {
+    size_t available = length - frame->head_len;
+    size_t pending_len = available < frame->payload_len ? available : frame->payload_len;
+    const char* pending = frame->payload;
+    uint64_t remaining = frame->payload_len - pending_len;
+    uint64_t offset = 0;
+    char* blocks[2] = {spare, buffer};
+    int next = 0;
+    *saved = file_fd >= 0;
+
+    while (1) {
+        bool writing = file_fd >= 0 && pending_len > 0;
+        size_t want = remaining < capacity ? remaining : capacity;
+        if (!writing && want == 0) {
+            break;
+        }
+
+        // Pedimos las dos entradas antes de preparar cualquiera; una que se obtuvo y no se preparó
+        // sale como NOP sin marca
+        struct io_uring_sqe* write_sqe = writing ? uringGetSqe(ring) : NULL;
+        struct io_uring_sqe* recv_sqe = want > 0 ? uringGetSqe(ring) : NULL;
+        if ((writing && write_sqe == NULL) || (want > 0 && recv_sqe == NULL)) {
+            return -1;
+        }
+        if (writing) {
+            uringPrepWrite(write_sqe, file_fd, pending, pending_len, offset, 2);
+        }
+        if (want > 0) {
+            uringPrepRecv(recv_sqe, dynamic_client, blocks[next], want, 0, 1);
+        }
+
+        int results[3];
+        if (!uringWaitResults(ring, writing + (want > 0), results, 3)) {
+            return -1;
+        }
+        if (writing) {
+            if (!uringFinishWrite(ring, file_fd, pending, pending_len, offset, results[2])) {
+                file_fd = -1;
+                *saved = false;
+            }
+            offset += pending_len;
+        }
+        if (want == 0) {
+            break;
+        }
+        int bytes = results[1];
+        if (bytes <= 0) {
+            return -1;
+        }
+        pending = blocks[next];
+        pending_len = bytes;
+        remaining -= bytes;
+        next ^= 1;
+    }
+
+    // Solo puede sobrar algo si el contenido completo ya venía en el buffer
+    if (frame->payload_len > available) {
+        return 0;
+    }
+    size_t used = frame->frame_len;
+    memmove(buffer, buffer + used, length - used);
+    return length - used;
+}
+
+/*
+    Versión io_uring de processConnection. Llega al mismo estado que processConnection, pero la
+    escritura de cada bloque va en el mismo lote que la recepción del siguiente. El archivo se cierra
+    antes de responder porque el resultado del cierre decide si se guardó
+*/
+uint64_t processConnectionUring(uring_t* ring, int dynamic_client, const char* target_server) {
+    char buffer[FRAME_MAX_HEAD + FRAME_CHUNK_SIZE];
+    char spare[FRAME_CHUNK_SIZE];
+    size_t length = 0;
+    uint64_t received = 0;
+
+    while(1){
+        frame_t frame;
+        frame_status_t status = nextMessage(buffer, length, &frame);
+        struct io_uring_sqe* sqe;
+        if (status == FRAME_INCOMPLETE) {
+            sqe = uringGetSqe(ring);
+            if (sqe == NULL) {
+                break;
+            }
+            uringPrepRecv(sqe, dynamic_client, buffer + length, sizeof(buffer) - length, 0, 1);
+            int bytes = uringWaitBatch(ring, 1, 1);
+            if (bytes <= 0) {
+                break;
+            }
+            length += bytes;
+            continue;
+        }
+
+        const char *msg = "REJECTED";
+        char reply[BUFFER_SIZE];
+
+        if (status == FRAME_READY) {
+            char alias[FRAME_MAX_ALIAS + 1];
+            char filename[FRAME_MAX_NAME + 1];
+            snprintf(alias, sizeof(alias), "%.*s", (int)frame.alias_len, frame.alias);
+            snprintf(filename, sizeof(filename), "%.*s", (int)frame.name_len, frame.filename);
+
+            // Si el archivo no es para este servidor igual hay que leer su contenido para llegar al siguiente mensaje
+            bool accepted = strcmp(alias, target_server) == 0;
+            int file_fd = accepted ? openFile(alias, filename) : -1;
+            if (accepted && file_fd < 0) {
+                perror("Error opening file");
+            }
+            bool saved;
+            ssize_t rest = streamPayloadUring(ring, dynamic_client, file_fd, buffer, spare, length, sizeof(spare), &frame, &saved);
+            // El cierre puede reportar el error de una escritura pendiente, así que se hace antes de
+            // elegir la respuesta, igual que en processConnection
+            if (file_fd >= 0 && close(file_fd) < 0) {
+                perror("Error closing file");
+                saved = false;
+            }
+            if (rest < 0) {
+                break;
+            }
+            length = rest;
+
+            if (accepted && saved) {
+                received += frame.payload_len;
+                msg = "File received successfully";
+                printf("[SERVER %s] File %s received\n", alias, filename);
+            } else if (accepted) {
+                // El contenido ya se leyó completo, así que la conexión puede seguir con el siguiente archivo
+                msg = SAVE_ERROR_MSG;
+                printf("[SERVER %s] Could not save file %s\n", alias, filename);
+            } else {
+                msg = "REJECTED - Wrong server";
+                printf("[SERVER %s] Rejected file for %s\n", target_server, alias);
+            }
+        } else {
+            length = 0;
+        }
+
+        size_t reply_len = status == FRAME_READY ? buildReply(reply, sizeof(reply), &frame, msg) : strlen(msg);
+        sqe = uringGetSqe(ring);
+        if (sqe == NULL) {
+            break;
+        }
+        uringPrepSend(sqe, dynamic_client, status == FRAME_READY ? reply : msg, reply_len, 4);
+        uringWaitBatch(ring, 1, 4);
+    }
+    return received;
+}
+
+/*
+    Función que guarda en las métricas del servidor una conexión atendida y se la reporta a la
+    política. Con el pool de manejadores se llama con handler_pool.mutex tomado, porque varios
+    manejadores terminan conexiones del mismo servidor a la vez
+*/
+void recordConnection(server_t* server, double wait, double busy, uint64_t bytes) {
+    sched_metrics_t* metrics = &server->metrics;
+    metrics->connections++;
+    metrics->bytes += bytes;
+    metrics->busy_seconds += busy;
+    metrics->wait_seconds += wait;
+    if (wait > metrics->max_wait_seconds) {
+        metrics->max_wait_seconds = wait;
+    }
+    if (shared_mem->policy->connectionDone) {
+        shared_mem->policy->connectionDone(server->index, bytes);
+    }
+    atomic_fetch_add(&server->served, 1);
+    atomic_fetch_add(&server->served_us, (unsigned long)(busy * 1e6));
+    atomic_fetch_add(&shared_mem->served, 1);
+    atomic_fetch_add(&shared_mem->served_us, (unsigned long)(busy * 1e6));
+}
+
+/*
+    Función que atiende una conexión de la cola del servidor, la cierra y la libera. Regresa los bytes
+    recibidos y deja en wait y busy cuánto esperó en la cola y cuánto tardó en atenderse. ring es NULL
+    en el camino bloqueante
+*/
+uint64_t serveConnection(uring_t* ring, server_t* server, connection_node_t* connection, double* wait, double* busy) {
+    *wait = secondsSince(&connection->enqueued);
+    struct timespec busy_start;
+    clock_gettime(CLOCK_MONOTONIC, &busy_start);
+    deadlineWatchReads(connection);
+    uint64_t bytes;
+    if (ring != NULL) {
+        bytes = processConnectionUring(ring, connection->dynamic_client, server->name);
+    } else {
+        bytes = processConnection(connection->dynamic_client, server->name);
+    }
+    deadlineDone(connection);
+    closeConnection(connection->dynamic_client, connection->dynamic_sock);
+    free(connection);
+    *busy = secondsSince(&busy_start);
+    return bytes;
+}
+
+/*
+    Conexión que el receptor le pasa al pool durante el turno de su servidor. in_flight cuenta las
+    conexiones del turno que siguen en el pool
+*/
+typedef struct {
+    connection_node_t* connection;
+    server_t* server;
+    int* in_flight;
+} handler_task_t;
+
+/*
+    Pool fijo de manejadores (-h) con una cola circular acotada de tareas. Si la cola se llena el
+    receptor espera, así que nunca hay más de HANDLER_QUEUE_PER_WORKER tareas por manejador
+    pendientes. Con -h 1 no hay pool y el receptor atiende cada conexión él mismo
+*/
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t task_ready;
+    pthread_cond_t task_space;
+    pthread_cond_t task_done;
+    handler_task_t* tasks;
+    int capacity;
+    int head;
+    int count;
+} handler_pool_t;
+
+handler_pool_t handler_pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .task_ready = PTHREAD_COND_INITIALIZER,
+    .task_space = PTHREAD_COND_INITIALIZER,
+    .task_done = PTHREAD_COND_INITIALIZER,
+};
+
+/*
+    Hilo manejador del pool. Cada uno tiene su propio anillo de io_uring
+*/
+void* handlerThread(void* arg) {
+    (void)arg;
+    uring_t ring;
+    bool use_uring = io_backend == BACKEND_URING && uringInit(&ring, URING_ENTRIES) == 0;
+
+    while (1) {
+        pthread_mutex_lock(&handler_pool.mutex);
+        while (handler_pool.count == 0) {
+            pthread_cond_wait(&handler_pool.task_ready, &handler_pool.mutex);
+        }
+        handler_task_t task = handler_pool.tasks[handler_pool.head];
+        handler_pool.head = (handler_pool.head + 1) % handler_pool.capacity;
+        handler_pool.count--;
+        pthread_cond_signal(&handler_pool.task_space);
+        pthread_mutex_unlock(&handler_pool.mutex);
+
+        double wait, busy;
+        uint64_t bytes = serveConnection(use_uring ? &ring : NULL, task.server, task.connection, &wait, &busy);
+
+        pthread_mutex_lock(&handler_pool.mutex);
+        recordConnection(task.server, wait, busy, bytes);
+        if (--*task.in_flight == 0) {
+            pthread_cond_broadcast(&handler_pool.task_done);
+            // El receptor puede estar esperando en la cola mientras el pool termina; sin marcar
+            // waiting, porque podría empezar a esperar justo después de revisar in_flight
+            uint64_t one = 1;
+            if (write(task.server->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+                perror("[-] Error waking server thread");
+            }
+        }
+        pthread_mutex_unlock(&handler_pool.mutex);
+    }
+    return NULL;
+}
+
+/*
+    Función que crea los manejadores del pool. Con -P cada proceso de servidor tiene su propio pool
+*/
+bool handlerPoolStart(int workers) {
+    handler_pool.capacity = workers * HANDLER_QUEUE_PER_WORKER;
+    handler_pool.tasks = calloc(handler_pool.capacity, sizeof(handler_task_t));
+    if (handler_pool.tasks == NULL) {
+        return false;
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_t handler_thread;
+        if (pthread_create(&handler_thread, NULL, handlerThread, NULL) != 0) {
+            return false;
+        }
+        pthread_detach(handler_thread);
+    }
+    return true;
+}
+
+/*
+    Función que forma una conexión del turno en el pool. Espera si la cola del pool está llena
+*/
+void handlerSubmit(server_t* server, connection_node_t* connection, int* in_flight) {
+    pthread_mutex_lock(&handler_pool.mutex);
+    while (handler_pool.count == handler_pool.capacity) {
+        pthread_cond_wait(&handler_pool.task_space, &handler_pool.mutex);
+    }
+    int tail = (handler_pool.head + handler_pool.count) % handler_pool.capacity;
+    handler_pool.tasks[tail] = (handler_task_t){connection, server, in_flight};
+    handler_pool.count++;
+    (*in_flight)++;
+    pthread_cond_signal(&handler_pool.task_ready);
+    pthread_mutex_unlock(&handler_pool.mutex);
+}
+
+/*
+    Función que regresa cuántas conexiones del turno siguen en el pool
+*/
+int handlerInFlight(int* in_flight) {
+    pthread_mutex_lock(&handler_pool.mutex);
+    int count = *in_flight;
+    pthread_mutex_unlock(&handler_pool.mutex);
+    return count;
+}
+
+/*
+    Función que espera a que el pool termine las conexiones del turno, así el servidor no suelta el
+    turno mientras todavía se escriben sus archivos
+*/
+void handlerWaitTurn(int* in_flight) {
+    pthread_mutex_lock(&handler_pool.mutex);
+    while (*in_flight > 0) {
+        pthread_cond_wait(&handler_pool.task_done, &handler_pool.mutex);
+    }
+    pthread_mutex_unlock(&handler_pool.mutex);
+}
+
+/*
+    Función que le da al receptor el turno del servidor que elige la política. Espera mientras no
+    haya a quién dárselo: en modo -w cuando ningún servidor tiene trabajo y con -k cuando todos los
+    servidores ya tienen turno
+*/
+server_t* acquireTurn(void) {
+    lockShared();
+    int server_index;
+    while ((server_index = shared_mem->policy->nextServer(shared_mem->current_server)) < 0) {
+        waitShared();
+    }
+    server_t* server = serverAt(server_index);
+    atomic_store(&server->receiving, true);
+    shared_mem->active_receivers++;
+    shared_mem->current_server = server_index;
+    pthread_mutex_unlock(&shared_mem->mutex);
+    return server;
+}
+
+/*
+    Función que espera el turno de un servidor en particular (-P). Mientras haya lugar entre los que
+    reciben, cualquier proceso que espera le pide a la política el siguiente servidor y le da el turno,
+    sea el suyo o el de otro proceso, al que despierta
+*/
+server_t* acquireServerTurn(server_t* server) {
+    lockShared();
+    while (!server->granted) {
+        int next_server = -1;
+        if (shared_mem->active_receivers < shared_mem->max_receivers) {
+            next_server = shared_mem->policy->nextServer(shared_mem->current_server);
+        }
+        if (next_server < 0) {
+            waitShared();
+            continue;
+        }
+        server_t* granted = serverAt(next_server);
+        granted->granted = true;
+        atomic_store(&granted->receiving, true);
+        shared_mem->active_receivers++;
+        shared_mem->current_server = next_server;
+        if (granted != server) {
+            wakeShared(true);
+        }
+    }
+    server->granted = false;
+    pthread_mutex_unlock(&shared_mem->mutex);
+    return server;
+}
+
+/*
+    Función que suelta el turno del servidor. En modo -w, si le quedaron conexiones, se forma al
+    final de la lista ready para que cada servidor con trabajo reciba su quantum por vuelta
+*/
+void releaseTurn(server_t* server) {
+    lockShared();
+    atomic_store(&server->receiving, false);
+    shared_mem->active_receivers--;
+    if (shared_mem->policy->turnEnd) {
+        shared_mem->policy->turnEnd(server->index);
+    }
+    if (work_conserving && atomic_load(&server->pending) > 0 && !atomic_load(&server->ready)) {
+        readyPush(server);
+    }
+    // Otro receptor puede estar esperando un servidor libre
+    wakeShared(false);
+    pthread_mutex_unlock(&shared_mem->mutex);
+}
+
+/*
+    Función de cada hilo receptor (-k). Toma el turno del servidor que sigue y procesa las conexiones
+    en su cola. La duración del turno y quién sigue los decide la política elegida con -s. Los hilos
+    no dependen del número de servidores, así que registrar más alias no crea más hilos. Con -P cada
+    proceso tiene un solo receptor que recibe su servidor en arg y solo atiende turnos de ese servidor
+*/
+void* receiverThread(void* arg) {
+    server_t* own_server = (server_t*)arg;
+
+    // Con io_uring cada receptor tiene su propio anillo, así nadie comparte la cola de envío
+    uring_t ring;
+    bool use_uring = false;
+    if (io_backend == BACKEND_URING) {
+        use_uring = uringInit(&ring, URING_ENTRIES) == 0;
+        if (!use_uring) {
+            perror("[-] io_uring setup failed, using blocking path");
+        }
+    }
+    
+    //Servidor simpre activo
+    while (1) {
+        server_t* server = own_server != NULL ? acquireServerTurn(own_server) : acquireTurn();
+        int server_index = server->index;
+        struct timespec turn_start;
+        clock_gettime(CLOCK_MONOTONIC, &turn_start);
+        
+        // Con quanta de menos de un segundo solo se anuncian los turnos que atienden algo
+        bool verbose_turns = quantum_ms >= 1000;
+        if (verbose_turns) {
+            printf("\n[SERVER %s] Starting turn\n", server->name);
+        }
+        
+        const sched_policy_t* policy = shared_mem->policy;
+        sched_metrics_t* metrics = &server->metrics;
+        int quantum = policy->quantum(server_index);
+        if (policy->turnStart) {
+            policy->turnStart(server_index);
+        }
+        metrics->turns++;
+
+        struct timespec deadline = quantumDeadline(&turn_start, quantum);
+        bool processed_any = false;
+        bool yielded = false;
+        int files_processed = 0;
+        int in_flight = 0;
+        
+        //Procesamos conexiones hasta que expire el quantum. Nos aseguramos que cada servidor tenga su turno y no se quede esperando indefinidamente.
+        while (!quantumExpired(&deadline) && (!policy->mayContinue || policy->mayContinue(server_index))) {
+            // Mientras no llegue nada esperamos en el eventfd en vez de revisar la cola cada segundo.
+            // En modo -w no esperamos en nuestra cola: si está vacía el turno pasa a otro servidor.
+            // Con el pool la cola se vacía en cuanto el receptor entrega cada conexión, así que
+            // mientras los manejadores sigan con conexiones del turno seguimos esperando en ella:
+            // el resto de una ráfaga llega en ese tiempo, igual que cuando el receptor atiende solo
+            bool pool_busy = !work_conserving && handler_count > 1 && handlerInFlight(&in_flight) > 0;
+            int timeout_ms = (processed_any && !pool_busy) || work_conserving ? 0 : remainingMs(&deadline);
+            connection_node_t* connection = waitNextConnection(server, timeout_ms);
+            //Nos aseguramos que el servidor procese las conexiones en su cola, si se le acaba el tiempo y aun hay conexiones, debe esperar su siguiente turno
+            // Si el tiempo se acaba mientras procesa una conexión, la termina y cede el turno
+            if (connection != NULL) {
+                processed_any = true;
+                files_processed++;
+                if (handler_count > 1) {
+                    handlerSubmit(server, connection, &in_flight);
+                } else {
+                    double wait, busy;
+                    uint64_t bytes = serveConnection(use_uring ? &ring : NULL, server, connection, &wait, &busy);
+                    recordConnection(server, wait, busy, bytes);
+                }
+            } else if (work_conserving) {
+                // Si otro servidor tiene conexiones le cedemos el turno; si nadie tiene, esperamos
+                // a que llegue algo sin soltar el turno
+                if (atomic_load(&shared_mem->ready_count) > 0) {
+                    yielded = true;
+                    break;
+                }
+                waitAnyConnection(server, remainingMs(&deadline));
+            } else if (processed_any && !pool_busy) {
+                // Dormimos hasta el final exacto del quantum con el mismo reloj monotónico
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+                }
+                break;
+            }
+        }
+        
+        handlerWaitTurn(&in_flight);
+        metrics->held_seconds += secondsSince(&turn_start);
+
+        if (yielded) {
+            printf("[SERVER %s] Queue empty, yielding turn after %d files\n",
+                   server->name, files_processed);
+        } else if (policy->mayContinue && !policy->mayContinue(server_index)) {
+            printf("[SERVER %s] Turn credit used up after %d files\n",
+                   server->name, files_processed);
+        } else if (!processed_any && verbose_turns) {
+            printf("[SERVER %s] Quantum expired with no files to process\n", 
+                   server->name);
+        } 
+        
+        //Finalizamos el turno y le avisamos a los receptores que esperan
+        releaseTurn(server);
+        
+        if (verbose_turns || processed_any) {
+            printf("[SERVER %s] Turn finished\n", server->name);
+        }
+    }
+    
+    return NULL;
+}
+
+/*
+    Hilo del proceso de un servidor (-P) que recibe del acceptor las conexiones por SCM_RIGHTS y las
+    forma en su cola. Si el acceptor cierra su extremo, el proceso termina
+*/
+void* channelThread(void* arg) {
+    server_t* server = (server_t*)arg;
+    while (1) {
+        struct timespec enqueued;
+        int fds[2] = {-1, -1};
+        char control[CMSG_SPACE(sizeof(fds))];
+        struct iovec iov = {.iov_base = &enqueued, .iov_len = sizeof(enqueued)};
+        struct msghdr msg = {
+            .msg_iov = &iov,
+            .msg_iovlen = 1,
+            .msg_control = control,
+            .msg_controllen = sizeof(control),
+        };
+        ssize_t bytes = recvmsg(server->channel[1], &msg, MSG_CMSG_CLOEXEC);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            exit(bytes == 0 ? 0 : 1);
+        }
+
+        int fd_count = 0;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(cmsg), fd_count * sizeof(int));
+        }
+        if (fd_count < 1 || bytes != sizeof(enqueued)) {
+            printf("[-] Invalid connection message for server %s\n", server->name);
+            for (int i = 0; i < fd_count; i++) {
+                close(fds[i]);
+            }
+            continue;
+        }
+        enqueueConnection(server, fds[0], fd_count > 1 ? fds[1] : -1, &enqueued);
+    }
+    return NULL;
+}
+
+/*
+    Función que corre el proceso de un servidor (-P): lo fija a un core, cierra los canales de los
+    demás servidores y atiende sus turnos. Termina cuando termina el acceptor
+*/
+/*
+    Función que cierra en el proceso de un servidor todo lo que heredó del acceptor menos stdio, su
+    canal, su eventfd y ready_event. Los procesos que se reinician se crean cuando los reactores ya
+    corren: sin esto se quedarían con los listeners, los epoll y los sockets de clientes a medio
+    saludo, y cuando el acceptor los cierra no sale el FIN ni se libera el puerto dinámico
+*/
+void closeInheritedFds(server_t* server) {
+    int keep[] = {server->channel[1], server->event_fd, ready_event};
+    int count = sizeof(keep) / sizeof(keep[0]);
+    // Ordenamos los que se quedan para cerrar los huecos entre ellos
+    for (int i = 1; i < count; i++) {
+        for (int j = i; j > 0 && keep[j - 1] > keep[j]; j--) {
+            int fd = keep[j];
+            keep[j] = keep[j - 1];
+            keep[j - 1] = fd;
+        }
+    }
+
+    unsigned int first = STDERR_FILENO + 1;
+    for (int i = 0; i <= count; i++) {
+        unsigned int last = i < count ? (unsigned int)keep[i] - 1 : ~0U;
+        if (i < count && (unsigned int)keep[i] < first) {
+            continue;
+        }
+        if (first <= last && close_range(first, last, 0) < 0) {
+            // Kernels sin close_range: cerramos uno por uno hasta el límite de descriptores
+            long max_fd = sysconf(_SC_OPEN_MAX);
+            for (long fd = first; fd <= (long)last && fd < max_fd; fd++) {
+                close(fd);
+            }
+        }
+        if (i < count) {
+            first = keep[i] + 1;
+        }
+    }
+}
+
+void serverProcess(server_t* server, pid_t acceptor_pid) {
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != acceptor_pid) {
+        exit(0);
+    }
+    // Ctrl+C le toca al acceptor, que imprime las métricas; al terminar, PDEATHSIG cierra este proceso.
+    // Los procesos que se reinician heredan las señales bloqueadas del hilo que los creó
+    signal(SIGINT, SIG_IGN);
+    sigset_t signals;
+    sigemptyset(&signals);
+    pthread_sigmask(SIG_SETMASK, &signals, NULL);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cores > 0 ? server->index % cores : 0, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+        perror("[-] Error pinning server process");
+    }
+
+    closeInheritedFds(server);
+
+    if (handler_count > 1 && !handlerPoolStart(handler_count)) {
+        perror("[-] Error starting connection handlers");
+        exit(1);
+    }
+    if (!deadlinesStart()) {
+        perror("[-] Error starting the deadline thread");
+        exit(1);
+    }
+    pthread_t channel_thread;
+    pthread_create(&channel_thread, NULL, channelThread, server);
+    receiverThread(server);
+    exit(0);
+}
+
+/*
+    Función que crea el proceso de un servidor (-P)
+*/
+bool spawnServerProcess(server_t* server) {
+    pid_t acceptor_pid = getpid();
+    // Lo que esté en el buffer de stdout se imprimiría dos veces
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("[-] Error creating server process");
+        return false;
+    }
+    if (pid == 0) {
+        serverProcess(server, acceptor_pid);
+    }
+    server->pid = pid;
+    printf("[*] Server %s running in process %d\n", server->name, (int)pid);
+    return true;
+}
+
+/*
+    Hilo del acceptor (-P) que espera a que termine el proceso de algún servidor. Si tenía el turno
+    lo libera, descarta las conexiones que tenía en su cola (se cerraron con el proceso) y lo vuelve
+    a crear, así una falla en un servidor no detiene a los demás
+*/
+void* processMonitor(void* arg) {
+    (void)arg;
+    while (1) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno != EINTR) {
+                perror("[-] Error waiting for server processes");
+                return NULL;
+            }
+            continue;
+        }
+
+        server_t* server = NULL;
+        for (int i = 0; i < serverCount(); i++) {
+            if (serverAt(i)->pid == pid) {
+                server = serverAt(i);
+                break;
+            }
+        }
+        if (server == NULL) {
+            continue;
+        }
+        if (WIFSIGNALED(status)) {
+            printf("[-] Server %s process %d killed by signal %d, restarting\n", server->name, (int)pid, WTERMSIG(status));
+        } else {
+            printf("[-] Server %s process %d exited with status %d, restarting\n", server->name, (int)pid, WEXITSTATUS(status));
+        }
+
+        lockShared();
+        if (atomic_load(&server->receiving)) {
+            atomic_store(&server->receiving, false);
+            shared_mem->active_receivers--;
+        }
+        server->granted = false;
+        if (atomic_load(&server->ready)) {
+            server_t* prev = NULL;
+            while ((prev != NULL ? prev->ready_next : shared_mem->ready_head) != server) {
+                prev = prev != NULL ? prev->ready_next : shared_mem->ready_head;
+            }
+            readyRemoveAfter(prev);
+        }
+        mpscInit(&server->queue);
+        // Las conexiones de su cola se perdieron; las que siguen en el canal las toma el proceso nuevo
+        admissionRelease(server, atomic_exchange(&server->pending, 0));
+        atomic_store(&server->waiting, 0);
+        wakeShared(true);
+        pthread_mutex_unlock(&shared_mem->mutex);
+
+        spawnServerProcess(server);
+    }
+    return NULL;
+}
+
+/*
+    Función que cambia el modo bloqueante de un descriptor
+*/
+int setNonBlocking(int fd, bool enable) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(fd, F_SETFL, flags);
+}
+
+/*
+    Función que registra un descriptor en el reactor en modo edge-triggered
+*/
+reactor_conn_t* reactorWatch(reactor_t* reactor, reactor_kind_t kind, int fd, int dynamic_sock) {
+    reactor_conn_t* conn = malloc(sizeof(reactor_conn_t));
+    if (conn == NULL) {
+        return NULL;
+    }
+    conn->kind = kind;
+    conn->fd = fd;
+    conn->dynamic_sock = dynamic_sock;
+    conn->pool_slot = -1;
+    conn->peer = NULL;
+    conn->next_free = NULL;
+    timerNodeInit(&conn->timer);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl ADD failed");
+        free(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+/*
+    Función que arma el plazo de saludo (-t) de una conexión del reactor
+*/
+void reactorDeadline(reactor_t* reactor, reactor_conn_t* conn) {
+    if (handshake_timeout_ms > 0) {
+        timerWheelAdd(&reactor->deadlines, &conn->timer, deadlineTick(handshake_timeout_ms));
+    }
+}
+
+/*
+    Función que deja de vigilar un descriptor y quita su plazo. No lo cierra, eso lo decide quien llama
+*/
+void reactorDrop(reactor_t* reactor, reactor_conn_t* conn) {
+    timerWheelCancel(&reactor->deadlines, &conn->timer);
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    conn->fd = -1;
+    conn->next_free = reactor->dropped;
+    reactor->dropped = conn;
+}
+
+/*
+    Función que crea el socket que escucha en un puerto dinámico en modo no bloqueante
+*/
+int openDynamicSocket(int dynamic_port, int backlog) {
+    int dynamic_sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (dynamic_sock < 0) {
+        perror("Socket error on dynamic port");
+        return -1;
+    }
+
+    struct sockaddr_in dynamic_addr;
+    dynamic_addr.sin_family = AF_INET;
+    dynamic_addr.sin_port = htons(dynamic_port);
+    dynamic_addr.sin_addr.s_addr = INADDR_ANY;
+
+    // Permitimos que se vuelva a usar el puerto después de terminar la ejecución del programa
+    int dyn_opt = 1;
+    if (setsockopt(dynamic_sock, SOL_SOCKET, SO_REUSEADDR, &dyn_opt, sizeof(dyn_opt)) < 0) {
+        perror("setsockopt SO_REUSEADDR failed on dynamic socket");
+        close(dynamic_sock);
+        return -1;
+    }
+
+    // Asignamos el socket a la dirección y puerto especificados. Un puerto ocupado no se reporta,
+    // quien llama lo salta y prueba el siguiente
+    if (bind(dynamic_sock, (struct sockaddr*)&dynamic_addr, sizeof(dynamic_addr)) < 0) {
+        int error = errno;
+        if (error != EADDRINUSE) {
+            perror("Bind error on dynamic port");
+        }
+        close(dynamic_sock);
+        errno = error;
+        return -1;
+    }
+
+    // Escuchamos conexiones entrantes
+    if (listen(dynamic_sock, backlog) < 0) {
+        perror("Listen error on dynamic port");
+        close(dynamic_sock);
+        return -1;
+    }
+    return dynamic_sock;
+}
+
+/*
+    Función que busca el siguiente puerto libre del rango del acceptor a partir de port_cursor,
+    revisando 64 puertos por palabra del mapa. Al llegar al final del rango vuelve a empezar.
+    Regresa su posición dentro del rango o -1 si todos están en uso
+*/
+int portFindFree(reactor_t* reactor) {
+    int base = reactor->port_first - port_map.first;
+    int scanned = 0;
+    while (scanned < reactor->port_count) {
+        int offset = reactor->port_cursor;
+        int bit = base + offset;
+        int span = 64 - bit % 64;
+        if (span > reactor->port_count - offset) {
+            span = reactor->port_count - offset;
+        }
+        uint64_t free_bits = ~atomic_load(&port_map.bits[bit / 64]) >> (bit % 64);
+        if (span < 64) {
+            free_bits &= ((uint64_t)1 << span) - 1;
+        }
+        if (free_bits != 0) {
+            int found = offset + __builtin_ctzll(free_bits);
+            reactor->port_cursor = (found + 1) % reactor->port_count;
+            return found;
+        }
+        scanned += span;
+        reactor->port_cursor = (offset + span) % reactor->port_count;
+    }
+    return -1;
+}
+
+/*
+    Función que aparta el siguiente puerto libre del rango del acceptor y abre su socket. La búsqueda
+    sigue donde se quedó la anterior, así un puerto que se acaba de liberar, y que puede tener
+    conexiones en TIME_WAIT, es de los últimos en volver a usarse. Los puertos que ocupa otro socket
+    (por ejemplo el puerto local de una conexión saliente) se saltan. Regresa el socket o -1
+*/
+int portAllocate(reactor_t* reactor, int backlog, int* dynamic_port) {
+    for (int attempt = 0; attempt < PORT_PROBE_LIMIT; attempt++) {
+        int offset = portFindFree(reactor);
+        if (offset < 0) {
+            break;
+        }
+        int port = reactor->port_first + offset;
+        int bit = port - port_map.first;
+        atomic_fetch_or(&port_map.bits[bit / 64], (uint64_t)1 << (bit % 64));
+        int dynamic_sock = openDynamicSocket(port, backlog);
+        if (dynamic_sock >= 0) {
+            *dynamic_port = port;
+            return dynamic_sock;
+        }
+        int error = errno;
+        portRelease(port);
+        // Sin descriptores o memoria ningún otro puerto va a funcionar
+        if (error != EADDRINUSE) {
+            break;
+        }
+        atomic_fetch_add(&shared_mem->ports_skipped, 1);
+    }
+    atomic_fetch_add(&shared_mem->ports_exhausted, 1);
+    return -1;
+}
+
+
+/*
+    Función que abre los puertos dinámicos del pool. Cada backend los registra después a su manera
+*/
+bool poolOpen(reactor_t* reactor, int size) {
+    reactor->pool_size = 0;
+    reactor->free_count = 0;
+    reactor->pool = NULL;
+    reactor->free_slots = NULL;
+    if (size <= 0) {
+        return true;
+    }
+
+    reactor->pool = calloc(size, sizeof(pool_slot_t));
+    reactor->free_slots = malloc(size * sizeof(int));
+    if (reactor->pool == NULL || reactor->free_slots == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < size; i++) {
+        int dynamic_port;
+        int dynamic_sock = portAllocate(reactor, POOL_BACKLOG, &dynamic_port);
+        if (dynamic_sock < 0) {
+            return false;
+        }
+        reactor->pool[i].port = dynamic_port;
+        reactor->pool[i].fd = dynamic_sock;
+        reactor->pool[i].assigned = false;
+        reactor->pool[i].conn = NULL;
+        reactor->free_slots[reactor->free_count++] = i;
+        reactor->pool_size++;
+    }
+    return true;
+}
+
+/*
+    Función que toma un puerto libre del pool, regresa -1 si todos están asignados
+*/
+int poolTake(reactor_t* reactor) {
+    if (reactor->free_count == 0) {
+        return -1;
+    }
+    int slot = reactor->free_slots[--reactor->free_count];
+    reactor->pool[slot].assigned = true;
+    return slot;
+}
+
+/*
+    Función que regresa un puerto al pool cuando su cliente ya se conectó o siguió en modo INLINE
+*/
+void poolRelease(reactor_t* reactor, int slot) {
+    if (!reactor->pool[slot].assigned) {
+        return;
+    }
+    reactor->pool[slot].assigned = false;
+    reactor->free_slots[reactor->free_count++] = slot;
+}
+
+/*
+    Función que acepta todas las conexiones pendientes en el puerto base. A cada cliente le
+    asignamos un puerto dinámico que ya está escuchando antes de avisarle, así nunca se conecta
+    a un puerto que todavía no existe
+*/
+void acceptBase(reactor_t* reactor) {
+    while (1) {
+        struct sockaddr_in client_addr;
+        socklen_t addr_size = sizeof(client_addr);
+        int client_port = accept4(reactor->base_sock, (struct sockaddr*)&client_addr, &addr_size, SOCK_NONBLOCK);
+        if (client_port < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Accept error");
+            }
+            return;
+        }
+
+        // Con todas las colas llenas (-L) el cliente no recibe puerto y se le pide que vuelva después
+        if (!admissionOpen()) {
+            sendBusy(NULL, NULL, client_port);
+            close(client_port);
+            continue;
+        }
+
+        // Asignamos un puerto dinámico al cliente mayor al puerto base, primero del pool
+        int dynamic_port;
+        reactor_conn_t* dynamic;
+        int slot = poolTake(reactor);
+        if (slot >= 0) {
+            dynamic_port = reactor->pool[slot].port;
+            dynamic = reactor->pool[slot].conn;
+        } else {
+            // Sin puertos libres en el pool abrimos uno solo para este cliente. Si tampoco hay en el
+            // rango le pedimos que vuelva después
+            int dynamic_sock = portAllocate(reactor, 1, &dynamic_port);
+            if (dynamic_sock < 0) {
+                sendBusy(NULL, NULL, client_port);
+                close(client_port);
+                continue;
+            }
+            dynamic = reactorWatch(reactor, REACTOR_DYNAMIC, dynamic_sock, -1);
+            if (dynamic == NULL) {
+                closeDynamicSocket(dynamic_sock);
+                close(client_port);
+                continue;
+            }
+        }
+
+        // Seguimos vigilando la conexión base por si el cliente usa el modo INLINE
+        reactor_conn_t* handshake = reactorWatch(reactor, REACTOR_HANDSHAKE, client_port, -1);
+        if (handshake != NULL) {
+            handshake->peer = dynamic;
+            dynamic->peer = handshake;
+            reactorDeadline(reactor, handshake);
+        } else {
+            reactorDeadline(reactor, dynamic);
+        }
+
+        //Enviamos el puerto dinámico al cliente. Los clientes anteriores ignoran los sufijos INLINE y FRAME
+        char port_msg[64];
+        snprintf(port_msg, sizeof(port_msg), "DYNAMIC_PORT|%d|INLINE|FRAME", dynamic_port);
+        send(client_port, port_msg, strlen(port_msg), MSG_NOSIGNAL);
+        if (handshake == NULL) {
+            close(client_port);
+        }
+
+        printf("[*] Assigned dynamic port %d to client\n", dynamic_port);
+    }
+}
+
+/*
+    Función que acepta a los clientes de un puerto del pool. El socket sigue escuchando, así que
+    el cliente se encola sin socket dinámico y el puerto vuelve a quedar libre
+*/
+void acceptPooled(reactor_t* reactor, reactor_conn_t* conn) {
+    while (1) {
+        int dynamic_client = accept4(conn->fd, NULL, NULL, SOCK_NONBLOCK);
+        if (dynamic_client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Accept error on dynamic port");
+            }
+            return;
+        }
+
+        if (conn->peer != NULL) {
+            conn->peer->peer = NULL;
+            conn->peer = NULL;
+        }
+        timerWheelCancel(&reactor->deadlines, &conn->timer);
+        poolRelease(reactor, conn->pool_slot);
+
+        reactor_conn_t* client = reactorWatch(reactor, REACTOR_CLIENT, dynamic_client, -1);
+        if (client == NULL) {
+            close(dynamic_client);
+        } else {
+            reactorDeadline(reactor, client);
+        }
+    }
+}
+
+/*
+    Función que acepta al cliente de un puerto dinámico. Cada puerto dinámico fuera del pool atiende
+    a un solo cliente, así que después de aceptarlo dejamos de vigilar el socket dinámico y vigilamos
+    al cliente
+*/
+void acceptDynamic(reactor_t* reactor, reactor_conn_t* conn) {
+    if (conn->pool_slot >= 0) {
+        acceptPooled(reactor, conn);
+        return;
+    }
+
+    int dynamic_sock = conn->fd;
+    int dynamic_client = accept4(dynamic_sock, NULL, NULL, SOCK_NONBLOCK);
+    if (dynamic_client < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            perror("Accept error on dynamic port");
+            reactorDrop(reactor, conn);
+            closeDynamicSocket(dynamic_sock);
+        }
+        return;
+    }
+
+    // El cliente eligió el puerto dinámico, su conexión base solo espera a que la cierre
+    if (conn->peer != NULL) {
+        conn->peer->peer = NULL;
+    }
+    reactorDrop(reactor, conn);
+    reactor_conn_t* client = reactorWatch(reactor, REACTOR_CLIENT, dynamic_client, dynamic_sock);
+    if (client == NULL) {
+        close(dynamic_client);
+        closeDynamicSocket(dynamic_sock);
+    } else {
+        reactorDeadline(reactor, client);
+    }
+}
+
+/*
+    Función que deja de esperar a un cliente en el puerto dinámico porque su subida llegó por
+    la conexión base o porque venció su plazo de saludo
+*/
+void releaseDynamic(reactor_t* reactor, reactor_conn_t* handshake) {
+    reactor_conn_t* dynamic = handshake->peer;
+    if (dynamic == NULL) {
+        return;
+    }
+    handshake->peer = NULL;
+    dynamic->peer = NULL;
+
+    // Los puertos del pool siguen escuchando para el siguiente cliente
+    if (dynamic->pool_slot >= 0) {
+        timerWheelCancel(&reactor->deadlines, &dynamic->timer);
+        poolRelease(reactor, dynamic->pool_slot);
+        return;
+    }
+    int dynamic_sock = dynamic->fd;
+    reactorDrop(reactor, dynamic);
+    closeDynamicSocket(dynamic_sock);
+}
+
+/*
+    Función que revisa si ya llegó el encabezado del cliente sin consumirlo. Cuando está completo
+    entregamos la conexión a la cola del servidor correspondiente, si llega incompleto esperamos
+    al siguiente aviso de epoll. También atiende las conexiones base en modo INLINE, que se
+    encolan sin socket dinámico
+*/
+void readHeader(reactor_t* reactor, reactor_conn_t* conn) {
+    int dynamic_client = conn->fd;
+    int dynamic_sock = conn->dynamic_sock;
+    char buffer[BUFFER_SIZE] = {0};
+
+    int bytes = recv(dynamic_client, buffer, sizeof(buffer) - 1, MSG_PEEK);
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+
+    if (bytes > 0) {
+        frame_t frame;
+        frame_status_t status = protocolParseHead(buffer, bytes, &frame);
+
+        if (status == FRAME_READY) {
+            releaseDynamic(reactor, conn);
+            reactorDrop(reactor, conn);
+            // processConnection usa recv bloqueante
+            setNonBlocking(dynamic_client, false);
+            if (!addQueue(&frame, dynamic_client, dynamic_sock)) {
+                closeConnection(dynamic_client, dynamic_sock);
+            }
+            return;
+        }
+
+        // El encabezado todavía puede completarse, salvo que ya llenamos el buffer
+        if (status == FRAME_INCOMPLETE && bytes < (int)sizeof(buffer) - 1) {
+            return;
+        }
+    }
+
+    // Si era una conexión base, el cliente siguió por el puerto dinámico y el socket dinámico sigue vivo,
+    // ahora con su propio plazo
+    if (conn->peer != NULL) {
+        conn->peer->peer = NULL;
+        reactorDeadline(reactor, conn->peer);
+    }
+    reactorDrop(reactor, conn);
+    closeConnection(dynamic_client, dynamic_sock);
+}
+
+/*
+    Función que cierra lo que venció su plazo de saludo: un cliente que no mandó su encabezado o un
+    puerto dinámico al que nunca se conectó nadie. Mientras la conexión base espera, el plazo es
+    suyo y al vencer también libera su puerto dinámico; el puerto solo tiene plazo propio si la
+    conexión base se cerró antes. Una conexión base cuyo cliente ya siguió por el puerto dinámico
+    solo se cierra, no cuenta como vencida
+*/
+void reactorExpire(reactor_t* reactor, reactor_conn_t* conn) {
+    bool stalled = conn->kind != REACTOR_HANDSHAKE || conn->peer != NULL;
+    releaseDynamic(reactor, conn);
+    if (conn->pool_slot >= 0) {
+        poolRelease(reactor, conn->pool_slot);
+        return;
+    }
+    int fd = conn->fd;
+    int dynamic_sock = conn->dynamic_sock;
+    reactorDrop(reactor, conn);
+    if (conn->kind == REACTOR_DYNAMIC) {
+        closeDynamicSocket(fd);
+    } else {
+        closeConnection(fd, dynamic_sock);
+    }
+    if (stalled) {
+        atomic_fetch_add(&shared_mem->handshake_timeouts, 1);
+        printf("[-] Client timed out before sending its header\n");
+    }
+}
+
+/*
+    Ciclo principal del reactor. Un solo hilo atiende el puerto base, los puertos dinámicos y
+    los encabezados de los clientes sin crear un hilo por conexión. Mientras haya plazos de
+    saludo pendientes epoll_wait despierta cada TIMER_TICK_MS para vencerlos
+*/
+void reactorLoop(reactor_t* reactor) {
+    struct epoll_event events[MAX_EVENTS];
+
+    // Los puertos del pool quedan vigilados todo el tiempo
+    for (int i = 0; i < reactor->pool_size; i++) {
+        reactor_conn_t* conn = reactorWatch(reactor, REACTOR_DYNAMIC, reactor->pool[i].fd, -1);
+        if (conn == NULL) {
+            return;
+        }
+        conn->pool_slot = i;
+        reactor->pool[i].conn = conn;
+    }
+
+    while (1) {
+        int timeout = reactor->deadlines.count > 0 ? TIMER_TICK_MS : -1;
+        int ready = epoll_wait(reactor->epoll_fd, events, MAX_EVENTS, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait failed");
+            return;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            reactor_conn_t* conn = events[i].data.ptr;
+            if (conn->fd < 0) {
+                continue;
+            }
+            switch (conn->kind) {
+                case REACTOR_BASE:
+                    acceptBase(reactor);
+                    break;
+                case REACTOR_DYNAMIC:
+                    acceptDynamic(reactor, conn);
+                    break;
+                case REACTOR_CLIENT:
+                case REACTOR_HANDSHAKE:
+                    readHeader(reactor, conn);
+                    break;
+            }
+        }
+
+        timer_node_t* expired = timerWheelAdvance(&reactor->deadlines, timerTicks(TIMER_TICK_MS));
+        while (expired != NULL) {
+            timer_node_t* next = expired->prev;
+            reactorExpire(reactor, timerEntry(expired, reactor_conn_t, timer));
+            expired = next;
+        }
+
+        while (reactor->dropped != NULL) {
+            reactor_conn_t* conn = reactor->dropped;
+            reactor->dropped = conn->next_free;
+            free(conn);
+        }
+    }
+}
+
+/*
+    Función que crea una conexión del backend io_uring
+*/
+uring_conn_t* uringConn(reactor_kind_t kind, int fd, int dynamic_sock) {
+    uring_conn_t* conn = malloc(sizeof(uring_conn_t));
+    if (conn == NULL) {
+        return NULL;
+    }
+    conn->kind = kind;
+    conn->fd = fd;
+    conn->dynamic_sock = dynamic_sock;
+    conn->pool_slot = -1;
+    conn->retrying = false;
+    conn->peer = NULL;
+    timerNodeInit(&conn->timer);
+    conn->retry_delay.tv_sec = 0;
+    conn->retry_delay.tv_nsec = 1000000;
+    return conn;
+}
+
+/*
+    Función que arma el plazo de saludo (-t) de una conexión del backend io_uring
+*/
+void uringDeadline(reactor_t* reactor, uring_conn_t* conn) {
+    if (handshake_timeout_ms > 0) {
+        timerWheelAdd(&reactor->deadlines, &conn->timer, deadlineTick(handshake_timeout_ms));
+    }
+}
+
+/*
+    Función que libera una conexión del backend io_uring junto con su plazo
+*/
+void uringConnFree(reactor_t* reactor, uring_conn_t* conn) {
+    timerWheelCancel(&reactor->deadlines, &conn->timer);
+    free(conn);
+}
+
+/*
+    Función que atiende un cliente nuevo del puerto base con io_uring. El aviso del puerto dinámico
+    va ligado a la lectura que detecta el modo INLINE, y la aceptación en el puerto dinámico sale
+    en el mismo lote
+*/
+void uringAcceptBase(reactor_t* reactor, uring_t* ring, int client_port) {
+    // Con todas las colas llenas (-L) el cliente no recibe puerto y se le pide que vuelva después
+    if (!admissionOpen()) {
+        sendBusy(NULL, NULL, client_port);
+        close(client_port);
+        return;
+    }
+
+    uring_conn_t* handshake = uringConn(REACTOR_HANDSHAKE, client_port, -1);
+    if (handshake == NULL) {
+        close(client_port);
+        return;
+    }
+
+    // Asignamos un puerto dinámico al cliente mayor al puerto base, primero del pool
+    int dynamic_port;
+    uring_conn_t* dynamic;
+    struct io_uring_sqe* accept_sqe = NULL;
+    int slot = poolTake(reactor);
+    if (slot >= 0) {
+        dynamic_port = reactor->pool[slot].port;
+        dynamic = reactor->pool[slot].conn;
+    } else {
+        // Sin puertos libres en el pool abrimos uno solo para este cliente. Si tampoco hay en el
+        // rango le pedimos que vuelva después
+        int dynamic_sock = portAllocate(reactor, 1, &dynamic_port);
+        if (dynamic_sock < 0) {
+            free(handshake);
+            sendBusy(NULL, NULL, client_port);
+            close(client_port);
+            return;
+        }
+        setNonBlocking(dynamic_sock, false);
+
+        dynamic = uringConn(REACTOR_DYNAMIC, dynamic_sock, -1);
+        accept_sqe = dynamic != NULL ? uringGetSqe(ring) : NULL;
+        if (accept_sqe == NULL) {
+            free(dynamic);
+            free(handshake);
+            closeDynamicSocket(dynamic_sock);
+            close(client_port);
+            return;
+        }
+    }
+
+    // Las entradas del aviso se piden antes de preparar nada. Si no hay, las que sí se obtuvieron
+    // salen como NOP sin marca y el cliente se cierra como si el puerto no existiera
+    struct io_uring_sqe* send_sqe = uringGetSqe(ring);
+    struct io_uring_sqe* recv_sqe = send_sqe != NULL ? uringGetSqe(ring) : NULL;
+    if (recv_sqe == NULL) {
+        printf("[-] No io_uring entries left for the client handshake\n");
+        if (slot >= 0) {
+            poolRelease(reactor, slot);
+        } else {
+            closeDynamicSocket(dynamic->fd);
+            free(dynamic);
+        }
+        free(handshake);
+        close(client_port);
+        return;
+    }
+    if (accept_sqe != NULL) {
+        uringPrepAccept(accept_sqe, dynamic->fd, (uint64_t)(uintptr_t)dynamic);
+    }
+    dynamic->peer = handshake;
+    handshake->peer = dynamic;
+    uringDeadline(reactor, handshake);
+
+    //Enviamos el puerto dinámico al cliente. Los clientes anteriores ignoran los sufijos INLINE y FRAME
+    char *port_msg = handshake->buffer + BUFFER_SIZE / 2;
+    snprintf(port_msg, BUFFER_SIZE / 2, "DYNAMIC_PORT|%d|INLINE|FRAME", dynamic_port);
+    uringPrepSend(send_sqe, client_port, port_msg, strlen(port_msg), 0);
+    send_sqe->flags |= IOSQE_IO_LINK;
+    uringPrepRecv(recv_sqe, client_port, handshake->buffer, BUFFER_SIZE / 2 - 1, MSG_PEEK, (uint64_t)(uintptr_t)handshake);
+
+    printf("[*] Assigned dynamic port %d to client\n", dynamic_port);
+}
+
+/*
+    Función que calcula cuánto se puede leer con MSG_PEEK. En la conexión base la mitad alta del
+    buffer guarda el aviso del puerto dinámico mientras se envía
+*/
+unsigned uringPeekSize(uring_conn_t* conn) {
+    return conn->kind == REACTOR_HANDSHAKE ? BUFFER_SIZE / 2 - 1 : BUFFER_SIZE - 1;
+}
+
+/*
+    Función que cancela la aceptación pendiente en un puerto dinámico propio. Si no hay entrada libre
+    en el anillo, shutdown sobre el socket que escucha la completa con -EINVAL, igual que la cancelación
+*/
+void uringCancelAccept(uring_t* ring, uring_conn_t* dynamic) {
+    struct io_uring_sqe* sqe = uringGetSqe(ring);
+    if (sqe == NULL) {
+        shutdown(dynamic->fd, SHUT_RDWR);
+        return;
+    }
+    uringPrepCancel(sqe, (uint64_t)(uintptr_t)dynamic, 0);
+}
+
+/*
+    Función que deja de esperar al cliente en el puerto dinámico de una conexión base, porque su
+    subida llegó por ahí o porque venció su plazo de saludo. Los puertos del pool siguen escuchando
+    para el siguiente cliente; en un puerto propio se cancela la aceptación pendiente
+*/
+void uringReleaseDynamic(reactor_t* reactor, uring_t* ring, uring_conn_t* handshake) {
+    uring_conn_t* dynamic = handshake->peer;
+    if (dynamic == NULL) {
+        return;
+    }
+    handshake->peer = NULL;
+    dynamic->peer = NULL;
+    timerWheelCancel(&reactor->deadlines, &dynamic->timer);
+    if (dynamic->pool_slot >= 0) {
+        poolRelease(reactor, dynamic->pool_slot);
+    } else {
+        uringCancelAccept(ring, dynamic);
+    }
+}
+
+/*
+    Función que revisa el encabezado que se leyó con MSG_PEEK. Si está completo encolamos la conexión,
+    si llegó incompleto volvemos a revisar después de un milisegundo. Si el encabezado llegó por la
+    conexión base cancelamos la aceptación pendiente en el puerto dinámico
+*/
+void uringReadHeader(reactor_t* reactor, uring_t* ring, uring_conn_t* conn, int bytes) {
+    if (bytes > 0) {
+        frame_t frame;
+        frame_status_t status = protocolParseHead(conn->buffer, bytes, &frame);
+
+        if (status == FRAME_READY) {
+            uringReleaseDynamic(reactor, ring, conn);
+            if (!addQueue(&frame, conn->fd, conn->dynamic_sock)) {
+                closeConnection(conn->fd, conn->dynamic_sock);
+            }
+            uringConnFree(reactor, conn);
+            return;
+        }
+
+        // El encabezado todavía puede completarse, salvo que ya llenamos el buffer. Sin entrada libre
+        // para la espera la conexión se cierra
+        struct io_uring_sqe* sqe = NULL;
+        if (status == FRAME_INCOMPLETE && bytes < (int)uringPeekSize(conn)) {
+            sqe = uringGetSqe(ring);
+        }
+        if (sqe != NULL) {
+            conn->retrying = true;
+            uringPrepTimeout(sqe, &conn->retry_delay, (uint64_t)(uintptr_t)conn);
+            return;
+        }
+    }
+
+    // Si era una conexión base, el cliente siguió por el puerto dinámico y la aceptación sigue pendiente,
+    // ahora con su propio plazo
+    if (conn->peer != NULL) {
+        conn->peer->peer = NULL;
+        uringDeadline(reactor, conn->peer);
+    }
+    closeConnection(conn->fd, conn->dynamic_sock);
+    uringConnFree(reactor, conn);
+}
+
+/*
+    Función que deja una lectura con MSG_PEEK pendiente en un cliente recién aceptado en un puerto
+    dinámico. Si no se puede, el cliente se cierra como si se hubiera desconectado
+*/
+void uringWatchClient(reactor_t* reactor, uring_t* ring, int client_sock, int dynamic_sock) {
+    uring_conn_t* client = uringConn(REACTOR_CLIENT, client_sock, dynamic_sock);
+    struct io_uring_sqe* sqe = client != NULL ? uringGetSqe(ring) : NULL;
+    if (sqe == NULL) {
+        free(client);
+        closeConnection(client_sock, dynamic_sock);
+        return;
+    }
+    uringDeadline(reactor, client);
+    uringPrepRecv(sqe, client_sock, client->buffer, sizeof(client->buffer) - 1, MSG_PEEK, (uint64_t)(uintptr_t)client);
+}
+
+/*
+    Función que atiende una aceptación completada en un puerto del pool. El puerto vuelve a quedar
+    libre y dejamos otra aceptación pendiente en el mismo socket. Regresa false si no hubo entrada
+    para esa aceptación; el anillo ya no puede enviar y el ciclo termina igual que si falla io_uring_enter
+*/
+bool uringAcceptPooled(reactor_t* reactor, uring_t* ring, uring_conn_t* conn, int res) {
+    if (res >= 0) {
+        timerWheelCancel(&reactor->deadlines, &conn->timer);
+        poolRelease(reactor, conn->pool_slot);
+        uringWatchClient(reactor, ring, res, -1);
+    } else if (res != -EINTR) {
+        errno = -res;
+        perror("Accept error on dynamic port");
+    }
+    struct io_uring_sqe* sqe = uringGetSqe(ring);
+    if (sqe == NULL) {
+        return false;
+    }
+    uringPrepAccept(sqe, conn->fd, (uint64_t)(uintptr_t)conn);
+    return true;
+}
+
+/*
+    Función que atiende un plazo de saludo vencido con io_uring, igual que reactorExpire. Los
+    clientes tienen una lectura pendiente, así que shutdown la completa con 0 y uringReadHeader los
+    cierra como a cualquiera que se desconecta. La aceptación de un puerto dinámico propio se
+    cancela y la de un puerto del pool sigue para el siguiente cliente
+*/
+void uringExpire(reactor_t* reactor, uring_t* ring, uring_conn_t* conn) {
+    bool stalled = conn->kind != REACTOR_HANDSHAKE || conn->peer != NULL;
+    uringReleaseDynamic(reactor, ring, conn);
+    if (conn->kind == REACTOR_DYNAMIC) {
+        if (conn->pool_slot >= 0) {
+            poolRelease(reactor, conn->pool_slot);
+        } else {
+            uringCancelAccept(ring, conn);
+        }
+        return;
+    }
+    shutdown(conn->fd, SHUT_RDWR);
+    if (stalled) {
+        atomic_fetch_add(&shared_mem->handshake_timeouts, 1);
+        printf("[-] Client timed out before sending its header\n");
+    }
+}
+
+/*
+    Ciclo del acceptor con io_uring. Aceptaciones, avisos de puerto y lecturas de encabezado se
+    preparan mientras se procesan las completadas y se envían juntas en un solo io_uring_enter.
+    Con plazo de saludo un timeout de TIMER_TICK_MS se vuelve a pedir cada vez que se completa
+    para avanzar la rueda
+*/
+void uringAcceptLoop(reactor_t* reactor) {
+    uring_t ring;
+    if (uringInit(&ring, URING_ENTRIES) < 0) {
+        perror("[-] Error creating io_uring");
+        return;
+    }
+
+    // Si falta una entrada para la aceptación base, el timeout o el pool, el ciclo ni siquiera empieza
+    bool running = true;
+    uring_conn_t* base = uringConn(REACTOR_BASE, reactor->base_sock, -1);
+    struct io_uring_sqe* sqe = uringGetSqe(&ring);
+    if (sqe == NULL) {
+        running = false;
+    } else {
+        uringPrepAccept(sqe, base->fd, (uint64_t)(uintptr_t)base);
+    }
+
+    uring_conn_t* tick = uringConn(REACTOR_BASE, -1, -1);
+    tick->retry_delay.tv_nsec = TIMER_TICK_MS * 1000000L;
+    if (handshake_timeout_ms > 0) {
+        sqe = uringGetSqe(&ring);
+        if (sqe == NULL) {
+            running = false;
+        } else {
+            uringPrepTimeout(sqe, &tick->retry_delay, (uint64_t)(uintptr_t)tick);
+        }
+    }
+
+    // Cada puerto del pool mantiene siempre una aceptación pendiente
+    for (int i = 0; i < reactor->pool_size && running; i++) {
+        setNonBlocking(reactor->pool[i].fd, false);
+        uring_conn_t* conn = uringConn(REACTOR_DYNAMIC, reactor->pool[i].fd, -1);
+        if (conn == NULL) {
+            uringClose(&ring);
+            return;
+        }
+        conn->pool_slot = i;
+        reactor->pool[i].conn = conn;
+        sqe = uringGetSqe(&ring);
+        if (sqe == NULL) {
+            running = false;
+            break;
+        }
+        uringPrepAccept(sqe, conn->fd, (uint64_t)(uintptr_t)conn);
+    }
+
+    while (running) {
+        if (uringSubmit(&ring, 1) < 0) {
+            perror("io_uring_enter failed");
+            break;
+        }
+
+        // Sin entrada para volver a pedir una aceptación o el timeout el anillo ya no puede enviar,
+        // así que el ciclo termina igual que si falla io_uring_enter
+        struct io_uring_cqe* cqe;
+        while (running && (cqe = uringPeekCqe(&ring)) != NULL) {
+            uring_conn_t* conn = (uring_conn_t*)(uintptr_t)cqe->user_data;
+            int res = cqe->res;
+            uringCqeSeen(&ring);
+
+            if (conn == NULL) {
+                continue;
+            }
+            if (conn == tick) {
+                timer_node_t* expired = timerWheelAdvance(&reactor->deadlines, timerTicks(TIMER_TICK_MS));
+                while (expired != NULL) {
+                    timer_node_t* next = expired->prev;
+                    uringExpire(reactor, &ring, timerEntry(expired, uring_conn_t, timer));
+                    expired = next;
+                }
+                sqe = uringGetSqe(&ring);
+                if (sqe == NULL) {
+                    running = false;
+                    continue;
+                }
+                uringPrepTimeout(sqe, &tick->retry_delay, (uint64_t)(uintptr_t)tick);
+                continue;
+            }
+
+            switch (conn->kind) {
+                case REACTOR_BASE:
+                    if (res >= 0) {
+                        uringAcceptBase(reactor, &ring, res);
+                    } else if (res != -EINTR) {
+                        errno = -res;
+                        perror("Accept error");
+                    }
+                    sqe = uringGetSqe(&ring);
+                    if (sqe == NULL) {
+                        running = false;
+                        break;
+                    }
+                    uringPrepAccept(sqe, conn->fd, (uint64_t)(uintptr_t)conn);
+                    break;
+                case REACTOR_DYNAMIC:
+                    if (conn->peer != NULL) {
+                        conn->peer->peer = NULL;
+                        conn->peer = NULL;
+                    }
+                    if (conn->pool_slot >= 0) {
+                        running = uringAcceptPooled(reactor, &ring, conn, res);
+                        break;
+                    }
+                    if (res >= 0) {
+                        uringWatchClient(reactor, &ring, res, conn->fd);
+                    } else {
+                        // -ECANCELED o -EINVAL después de shutdown: el cliente siguió en modo INLINE o venció su plazo
+                        if (res != -ECANCELED && res != -EINVAL) {
+                            errno = -res;
+                            perror("Accept error on dynamic port");
+                        }
+                        closeDynamicSocket(conn->fd);
+                    }
+                    uringConnFree(reactor, conn);
+                    break;
+                case REACTOR_CLIENT:
+                case REACTOR_HANDSHAKE:
+                    if (conn->retrying) {
+                        conn->retrying = false;
+                        sqe = uringGetSqe(&ring);
+                        if (sqe == NULL) {
+                            uringReadHeader(reactor, &ring, conn, -1);
+                            break;
+                        }
+                        uringPrepRecv(sqe, conn->fd, conn->buffer, uringPeekSize(conn), MSG_PEEK, (uint64_t)(uintptr_t)conn);
+                    } else {
+                        uringReadHeader(reactor, &ring, conn, res);
+                    }
+                    break;
+            }
+        }
+    }
+
+    free(base);
+    free(tick);
+    uringClose(&ring);
+}
+
+/*
+    Función que crea el socket del puerto base. Con varios acceptors cada uno abre el suyo con
+    SO_REUSEPORT y el kernel reparte las conexiones nuevas entre ellos
+*/
+int openBaseSocket(bool reuse_port) {
+    //Creamos el socket principal para el puerto base
+    int port_s = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (port_s < 0) {
+        perror("[-] Error creating socket");
+        return -1;
+    }
+
+    int opt = 1;
+    //Permitimos que se vuelva a usar el puerto después de terminar la ejecución del programa
+    if (setsockopt(port_s, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEADDR failed");
+        close(port_s);
+        return -1;
+    }
+    if (reuse_port && setsockopt(port_s, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEPORT failed");
+        close(port_s);
+        return -1;
+    }
+
+    //Configuramos la dirección del servidor    
+    struct sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(server_port);
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+
+    //Asignamos el socket a la dirección y puerto especificados
+    if (bind(port_s, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("[-] Error binding");
+        close(port_s);
+        return -1;
+    }
+
+    //Escuchamos conexiones entrantes. Con el reactor la cola puede ser tan grande como permita el kernel
+    if (listen(port_s, SOMAXCONN) < 0) {
+        perror("[-] Error on listen");
+        close(port_s);
+        return -1;
+    }
+    return port_s;
+}
+
+/*
+    Función que avisa si el rango de puertos dinámicos se encima con el de puertos efímeros del
+    sistema, de donde salen los puertos locales de las conexiones salientes. Esos puertos se saltan
+    al asignar, pero con un rango aparte no hay que probarlos
+*/
+void warnEphemeralOverlap(void) {
+    FILE* range_file = fopen("/proc/sys/net/ipv4/ip_local_port_range", "r");
+    if (range_file == NULL) {
+        return;
+    }
+    int low, high;
+    if (fscanf(range_file, "%d %d", &low, &high) == 2 && low <= dynamic_last && high >= dynamic_first) {
+        printf("[*] Dynamic ports overlap the ephemeral range %d-%d, ports in use are skipped (see -D)\n", low, high);
+    }
+    fclose(range_file);
+}
+
+/*
+    Función del hilo de cada acceptor. Con más de un acceptor fijamos cada hilo a un núcleo
+    distinto para que los saludos escalen con el número de núcleos
+*/
+void* acceptorThread(void* arg) {
+    reactor_t* reactor = (reactor_t*)arg;
+    timerWheelInit(&reactor->deadlines, timerTicks(TIMER_TICK_MS));
+
+    if (num_acceptors > 1) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus > 0) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(reactor->index % cpus, &cpuset);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        }
+    }
+
+    if (io_backend == BACKEND_URING) {
+        // io_uring espera en el kernel, así que el socket base vuelve a ser bloqueante
+        setNonBlocking(reactor->base_sock, false);
+        uringAcceptLoop(reactor);
+        close(reactor->base_sock);
+        return NULL;
+    }
+
+    reactor->epoll_fd = epoll_create1(0);
+    if (reactor->epoll_fd < 0) {
+        perror("[-] Error creating epoll");
+        close(reactor->base_sock);
+        return NULL;
+    }
+    if (!reactorWatch(reactor, REACTOR_BASE, reactor->base_sock, -1)) {
+        close(reactor->epoll_fd);
+        close(reactor->base_sock);
+        return NULL;
+    }
+
+    reactorLoop(reactor);
+
+    close(reactor->epoll_fd);
+    close(reactor->base_sock);
+    return NULL;
+}
+
+/*
+    Función principal que inicializa el servidor, asignar puertos dinámicos a los clientes para recibir archivos y guardarlos en el directorio correspondiente (s01, s02, s03, s04 o cualquier alias registrado), 
+    memoria compartida, hilos y espera conexiones entrantes
+*/
+int main(int argc, char *argv[]) {
+    const sched_policy_t* policy = &sched_policies[0];
+    const char* weight_list = NULL;
+    int max_receivers = 1;
+    int opt_char;
+    while ((opt_char = getopt(argc, argv, "Aa:b:D:h:k:L:l:Pp:q:r:s:t:wW:")) != -1) {
+        switch (opt_char) {
+            case 'A':
+                auto_register = true;
+                break;
+            case 'P':
+                process_mode = true;
+                break;
+            case 'b':
+                if (strcmp(optarg, "epoll") == 0) {
+                    io_backend = BACKEND_EPOLL;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    io_backend = BACKEND_URING;
+                } else {
+                    printf("Unknown backend: %s (use epoll or uring)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+                if (strcmp(optarg, "splice") == 0) {
+                    recv_path = RECV_SPLICE;
+                } else if (strcmp(optarg, "copy") == 0) {
+                    recv_path = RECV_COPY;
+                } else {
+                    printf("Unknown receive path: %s (use splice or copy)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                pool_size = atoi(optarg);
+                break;
+            case 'D':
+                if (sscanf(optarg, "%d-%d", &dynamic_first, &dynamic_last) != 2 || dynamic_first < 1 ||
+                    dynamic_last > 65535 || dynamic_first > dynamic_last ||
+                    (dynamic_first <= server_port && server_port <= dynamic_last)) {
+                    printf("Dynamic ports must be a range without the base port %d: -D 50000-59999\n", server_port);
+                    return 1;
+                }
+                break;
+            case 'a':
+                num_acceptors = atoi(optarg);
+                if (num_acceptors < 1) {
+                    num_acceptors = 1;
+                }
+                break;
+            case 'h':
+                handler_count = atoi(optarg);
+                if (handler_count < 1) {
+                    printf("Handlers must be at least 1\n");
+                    return 1;
+                }
+                break;
+            case 'k':
+                max_receivers = atoi(optarg);
+                if (max_receivers < 1) {
+                    printf("Concurrent receivers must be at least 1\n");
+                    return 1;
+                }
+                break;
+            case 'l':
+                queue_limit = atoi(optarg);
+                if (queue_limit < 0) {
+                    printf("Queue limit must be 0 (no limit) or more\n");
+                    return 1;
+                }
+                break;
+            case 'L':
+                total_limit = atoi(optarg);
+                if (total_limit < 0) {
+                    printf("Total queue limit must be 0 (no limit) or more\n");
+                    return 1;
+                }
+                break;
+            case 't': {
+                // Los plazos que no se den conservan su valor por omisión
+                int timeouts[3] = {handshake_timeout_ms, queue_timeout_ms, read_timeout_ms};
+                int given = sscanf(optarg, "%d,%d,%d", &timeouts[0], &timeouts[1], &timeouts[2]);
+                if (given < 1 || timeouts[0] < 0 || timeouts[1] < 0 || timeouts[2] < 0) {
+                    printf("Timeouts must be 0 (no timeout) or more ms: -t handshake,queue,read\n");
+                    return 1;
+                }
+                handshake_timeout_ms = timeouts[0];
+                queue_timeout_ms = timeouts[1];
+                read_timeout_ms = timeouts[2];
+                break;
+            }
+            case 'w':
+                work_conserving = true;
+                break;
+            case 'q':
+                quantum_ms = atoi(optarg);
+                if (quantum_ms < 1) {
+                    printf("The quantum must be at least 1 ms\n");
+                    return 1;
+                }
+                break;
+            case 's':
+                policy = findPolicy(optarg);
+                if (policy == NULL) {
+                    printf("Unknown scheduling policy: %s (use rr, wrr, drr or sqf)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'W':
+                weight_list = optarg;
+                break;
+            default:
+                printf("Use: %s [-b epoll|uring] [-r splice|copy] [-p pool_size] [-D first-last] [-a acceptors] [-k receivers] [-h handlers] [-l queue_limit] [-L total_limit] [-t handshake_ms,queue_ms,read_ms] [-w] [-q quantum_ms] [-s rr|wrr|drr|sqf] [-W w1,w2,...] [-A] [-P] <alias>...\n", argv[0]);
+                return 1;
+        }
+    }
+
+ 
+    if (argc - optind < 1 && !auto_register) { 
+        printf("Use: %s [-b epoll|uring] [-r splice|copy] [-p pool_size] [-D first-last] [-a acceptors] [-k receivers] [-h handlers] [-l queue_limit] [-L total_limit] [-t handshake_ms,queue_ms,read_ms] [-w] [-q quantum_ms] [-s rr|wrr|drr|sqf] [-W w1,w2,...] [-A] [-P] <alias>...\n", argv[0]);
+        return 1;
+    }
+
+    // Cada acceptor reparte puertos de su propio rango para que nunca choquen entre ellos
+    int port_range = (dynamic_last - dynamic_first + 1) / num_acceptors;
+    if (port_range <= pool_size) {
+        printf("[-] Too many acceptors for the dynamic port range\n");
+        return 1;
+    }
+
+    // Con -P los procesos de los servidores no ven los alias que se registren después de crearlos
+    if (process_mode && auto_register) {
+        printf("-A cannot be combined with -P\n");
+        return 1;
+    }
+    if (process_mode) {
+        // La memoria compartida y los servidores se reparten de una región de shm_open. El nombre se
+        // borra en cuanto se mapea: los procesos de los servidores la heredan con fork
+        int server_chunks = (argc - optind + SERVER_CHUNK - 1) / SERVER_CHUNK;
+        size_t port_bytes = (size_t)(dynamic_last - dynamic_first + 64) / 64 * sizeof(uint64_t);
+        size_t arena_size = ((sizeof(shared_memory_t) + 63) & ~(size_t)63) + ((port_bytes + 63) & ~(size_t)63) +
+                            (size_t)server_chunks * SERVER_CHUNK * sizeof(server_t);
+        char shm_name[64];
+        snprintf(shm_name, sizeof(shm_name), "/server5.%d", (int)getpid());
+        int shm_fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (shm_fd < 0 || ftruncate(shm_fd, arena_size) < 0) {
+            perror("[-] Error creating shared memory");
+            return 1;
+        }
+        shm_arena = mmap(NULL, arena_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        shm_unlink(shm_name);
+        close(shm_fd);
+        if (shm_arena == MAP_FAILED) {
+            perror("[-] Error mapping shared memory");
+            return 1;
+        }
+        shm_arena_left = arena_size;
+        shared_mem = sharedAlloc(sizeof(shared_memory_t));
+    } else {
+        shared_mem = mmap(NULL, sizeof(shared_memory_t), PROT_READ | PROT_WRITE, 
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    // El mapa de puertos va antes que los servidores para que quepa en la región de -P
+    port_map.first = dynamic_first;
+    port_map.count = dynamic_last - dynamic_first + 1;
+    port_map.bits = sharedAlloc((size_t)(port_map.count + 63) / 64 * sizeof(uint64_t));
+    if (port_map.bits == NULL) {
+        perror("[-] Error creating dynamic port map");
+        return 1;
+    }
+
+    pthread_rwlock_init(&registry.lock, NULL);
+    registry.slot_count = REGISTRY_INITIAL_SLOTS;
+    registry.slots = calloc(registry.slot_count, sizeof(int));
+    ready_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (registry.slots == NULL || ready_event < 0) {
+        perror("[-] Error creating server registry");
+        return 1;
+    }
+
+    // Los pesos de -W van en el orden de los alias; los que falten y los alias registrados con -A pesan 1
+    const char* weight_next = weight_list;
+    for (int i = optind; i < argc; i++) {
+        int weight = 1;
+        if (weight_next != NULL && *weight_next != '\0') {
+            char* end;
+            weight = (int)strtol(weight_next, &end, 10);
+            if (end == weight_next || weight < 1 || (*end != ',' && *end != '\0')) {
+                printf("Weights must be positive integers in alias order: -W 4,2,1,1\n");
+                return 1;
+            }
+            weight_next = *end == ',' ? end + 1 : end;
+        }
+        if (!validAlias(argv[i])) {
+            printf("Invalid alias: %s\n", argv[i]);
+            return 1;
+        }
+        if (registerServer(argv[i], weight) < 0) {
+            printf("[-] Error registering server %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (weight_next != NULL && *weight_next != '\0') {
+        printf("More weights than aliases: -W %s\n", weight_list);
+        return 1;
+    }
+
+    // Cola más corta primero siempre cede el turno cuando la cola se vacía
+    if (strcmp(policy->name, "sqf") == 0) {
+        work_conserving = true;
+    }
+
+    printf("[*] Scheduling policy %s initialized (quantum: %d ms)\n", policy->name, quantum_ms);
+    printf("[*] Turn order:");
+    for (int i = 0; i < serverCount(); i++) {
+        printf("%s %s (weight %d)", i > 0 ? " ->" : "", serverAt(i)->name, serverAt(i)->weight);
+    }
+    printf("\n");
+    if (auto_register) {
+        printf("[*] Unknown aliases are registered on their first connection\n");
+    }
+    if (handler_count > 1) {
+        printf("[*] Connection handlers: %d %s\n", handler_count, process_mode ? "per server process" : "shared by the receivers");
+    }
+    if (queue_limit > 0 || total_limit > 0) {
+        printf("[*] Admission control: up to %d queued per server, %d in total (0 = no limit), BUSY beyond that\n",
+               queue_limit, total_limit);
+    }
+    printf("[*] Timeouts: handshake %d ms, queue %d ms, read %d ms (0 = none)\n",
+           handshake_timeout_ms, queue_timeout_ms, read_timeout_ms);
+    if (max_receivers > 1) {
+        printf("[*] Concurrent receivers: up to %d servers hold a turn at once\n", max_receivers);
+    }
+    if (work_conserving) {
+        printf("[*] Work-conserving: idle servers pass the turn to the next one with pending files\n");
+    }
+    printf("[*] I/O backend: %s\n", io_backend == BACKEND_URING ? "io_uring" : "epoll");
+    if (io_backend == BACKEND_EPOLL) {
+        printf("[*] Receive path: %s\n", recv_path == RECV_SPLICE ? "splice" : "copy");
+    }
+    printf("[*] Acceptors: %d%s\n", num_acceptors, num_acceptors > 1 ? " (SO_REUSEPORT)" : "");
+    printf("[*] Dynamic ports: %d-%d, %d per acceptor\n", dynamic_first, dynamic_last, port_range);
+    warnEphemeralOverlap();
+    printf("[*] LISTENING on port %d...\n\n", server_port);
+
+    // El primer turno es del primer alias: la política empieza a buscar después del último
+    shared_mem->current_server = -1;
+    shared_mem->max_receivers = max_receivers;
+    shared_mem->ready_head = NULL;
+    shared_mem->ready_tail = NULL;
+    atomic_init(&shared_mem->ready_count, 0);
+    atomic_init(&shared_mem->ready_waiters, 0);
+    atomic_init(&shared_mem->turn_seq, 0);
+    atomic_init(&shared_mem->admitted, 0);
+    atomic_init(&shared_mem->busy_replies, 0);
+    atomic_init(&shared_mem->served, 0);
+    atomic_init(&shared_mem->served_us, 0);
+    atomic_init(&shared_mem->handshake_timeouts, 0);
+    atomic_init(&shared_mem->queue_timeouts, 0);
+    atomic_init(&shared_mem->read_timeouts, 0);
+    atomic_init(&shared_mem->ports_skipped, 0);
+    atomic_init(&shared_mem->ports_exhausted, 0);
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    if (process_mode) {
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    }
+    pthread_mutex_init(&shared_mem->mutex, &mutex_attr);
+    pthread_cond_init(&shared_mem->turn_cond, NULL);
+    shared_mem->policy = policy;
+    clock_gettime(CLOCK_MONOTONIC, &shared_mem->started);
+
+    // Los procesos de los servidores se crean antes de bloquear las señales y de abrir los sockets.
+    // Los que se reinician después heredan todo eso y lo cierran con closeInheritedFds
+    if (process_mode) {
+        printf("[*] Process per server: turns coordinated through shared memory\n");
+        for (int i = 0; i < serverCount(); i++) {
+            server_t* server = serverAt(i);
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, server->channel) < 0) {
+                perror("[-] Error creating server channel");
+                return 1;
+            }
+        }
+        for (int i = 0; i < serverCount(); i++) {
+            if (!spawnServerProcess(serverAt(i))) {
+                return 1;
+            }
+        }
+    }
+
+    // SIGINT y SIGTERM solo los recibe el hilo de métricas; los hilos creados después heredan la máscara
+    static sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    pthread_t metrics_thread;
+    pthread_create(&metrics_thread, NULL, metricsThread, &stop_signals);
+    pthread_detach(metrics_thread);
+
+    if (process_mode) {
+        pthread_t monitor_thread;
+        pthread_create(&monitor_thread, NULL, processMonitor, NULL);
+        pthread_detach(monitor_thread);
+    } else {
+        if (handler_count > 1 && !handlerPoolStart(handler_count)) {
+            perror("[-] Error starting connection handlers");
+            return 1;
+        }
+        if (!deadlinesStart()) {
+            perror("[-] Error starting the deadline thread");
+            return 1;
+        }
+        for (int i = 0; i < max_receivers; i++) {
+            pthread_t receiver_thread;
+            pthread_create(&receiver_thread, NULL, receiverThread, NULL);
+            pthread_detach(receiver_thread);
+        }
+    }
+
+    reactor_t* reactors = calloc(num_acceptors, sizeof(reactor_t));
+    for (int i = 0; i < num_acceptors; i++) {
+        reactors[i].index = i;
+        reactors[i].port_first = dynamic_first + i * port_range;
+        reactors[i].port_count = port_range;
+        reactors[i].port_cursor = 0;
+        reactors[i].dropped = NULL;
+        reactors[i].base_sock = openBaseSocket(num_acceptors > 1);
+        if (reactors[i].base_sock < 0) {
+            return 1;
+        }
+        if (!poolOpen(&reactors[i], pool_size)) {
+            printf("[-] Error opening dynamic port pool\n");
+            return 1;
+        }
+    }
+    printf("[*] Dynamic port pool: %d ports per acceptor\n", reactors[0].pool_size);
+
+    pthread_t* acceptor_threads = malloc(num_acceptors * sizeof(pthread_t));
+    for (int i = 0; i < num_acceptors; i++) {
+        pthread_create(&acceptor_threads[i], NULL, acceptorThread, &reactors[i]);
+    }
+    for (int i = 0; i < num_acceptors; i++) {
+        pthread_join(acceptor_threads[i], NULL);
+    }
+
     return 0;
 }
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "timerWheel.h"
+
+//timerBench.c
+
+/*
+    Mide la rueda de timerWheel.h con muchos temporizadores vivos, como los plazos de server5. Agrega
+    los temporizadores con vencimientos al azar dentro de RANGE ticks, los vuelve a armar como hace
+    un plazo de lectura cada vez que llegan datos, cancela la mitad y avanza tick por tick hasta que
+    vencen todos. Se reportan nanosegundos por operación y se revisa que cada temporizador salga
+    justo en su tick, ni antes ni después.
+    Compilar: gcc -Wall -O2 -pthread -o timerBench timerBench.c
+*/
+
+typedef struct {
+    timer_node_t node;
+    uint64_t due;
+} bench_timer_t;
+
+double elapsedSeconds(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void report(const char* name, long ops, struct timespec start, struct timespec end) {
+    double seconds = elapsedSeconds(start, end);
+    printf("[*] %-8s %10ld ops  %8.1f ns/op\n", name, ops, ops > 0 ? seconds * 1e9 / ops : 0.0);
+}
+
+/*
+    Función que da un vencimiento al azar entre 1 y range ticks después de now
+*/
+uint64_t randomDue(unsigned int* seed, uint64_t now, long range) {
+    return now + 1 + rand_r(seed) % range;
+}
+
+int main(int argc, char *argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : 100000;
+    long range = argc > 2 ? atol(argv[2]) : 300;
+    if (count <= 0 || range <= 0) {
+        printf("USE: %s [TIMERS] [RANGE_TICKS]\n", argv[0]);
+        return 1;
+    }
+
+    bench_timer_t* timers = calloc(count, sizeof(bench_timer_t));
+    timer_wheel_t* wheel = malloc(sizeof(timer_wheel_t));
+    if (timers == NULL || wheel == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    // El reloj empieza lejos de 0 para que las ranuras no queden alineadas con el inicio
+    uint64_t start_tick = 1000003;
+    unsigned int seed = 12345;
+    timerWheelInit(wheel, start_tick);
+    for (long i = 0; i < count; i++) {
+        timerNodeInit(&timers[i].node);
+        timers[i].due = randomDue(&seed, start_tick, range);
+    }
+    printf("[*] %ld timers, deadlines within %ld ticks\n", count, range);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i++) {
+        timerWheelAdd(wheel, &timers[i].node, timers[i].due);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("add", count, start, end);
+
+    // Volver a armar es cancelar y agregar con el nuevo vencimiento
+    for (long i = 0; i < count; i++) {
+        timers[i].due = randomDue(&seed, start_tick, range);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i++) {
+        timerWheelCancel(wheel, &timers[i].node);
+        timerWheelAdd(wheel, &timers[i].node, timers[i].due);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("rearm", count, start, end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < count; i += 2) {
+        timerWheelCancel(wheel, &timers[i].node);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("cancel", (count + 1) / 2, start, end);
+
+    long expired = 0;
+    long early = 0;
+    long late = 0;
+    long ticks = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t now = start_tick + 1; wheel->count > 0; now++) {
+        timer_node_t* node = timerWheelAdvance(wheel, now);
+        ticks++;
+        while (node != NULL) {
+            bench_timer_t* timer = timerEntry(node, bench_timer_t, node);
+            if (timer->due > now) {
+                early++;
+            } else if (timer->due < now) {
+                late++;
+            }
+            expired++;
+            node = node->prev;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("expire", expired, start, end);
+    printf("[*] %ld ticks, %ld expired, %ld early, %ld late\n", ticks, expired, early, late);
+
+    free(wheel);
+    free(timers);
+    return early == 0 && late == 0 && expired == count / 2 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+/*
+    Rueda de temporizadores jerárquica para los plazos de las conexiones. El tiempo avanza en ticks
+    y cada nivel tiene TIMER_WHEEL_SIZE ranuras: el nivel 0 cubre los siguientes 64 ticks, el 1 los
+    siguientes 64 * 64 y así hasta TIMER_WHEEL_LEVELS niveles. Agregar y cancelar un temporizador
+    es O(1) porque cada ranura es una lista doblemente ligada con nodo centinela; al avanzar solo se
+    revisa la ranura del tick actual y, cada 64 ticks, se reparte una ranura del nivel de arriba.
+    Así el costo no depende de cuántos temporizadores haya; timerBench.c lo mide.
+    El nodo va dentro de la estructura de quien lo usa y timerEntry la recupera. La rueda no tiene
+    candado: la usa un solo hilo o quien llama la protege.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS 4
+
+#define timerEntry(node, type, member) ((type *)((char *)(node) - offsetof(type, member)))
+
+typedef struct timer_node {
+    struct timer_node *next;
+    struct timer_node *prev;
+    uint64_t expires;
+} timer_node_t;
+
+typedef struct {
+    uint64_t now;
+    size_t count;
+    timer_node_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+} timer_wheel_t;
+
+/*
+    Función que regresa el tick actual del reloj monotónico con ticks de tick_ms milisegundos
+*/
+static inline uint64_t timerTicks(int tick_ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000) / tick_ms;
+}
+
+static inline void timerWheelInit(timer_wheel_t *wheel, uint64_t now) {
+    wheel->now = now;
+    wheel->count = 0;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < TIMER_WHEEL_SIZE; i++) {
+            wheel->slots[level][i].next = &wheel->slots[level][i];
+            wheel->slots[level][i].prev = &wheel->slots[level][i];
+        }
+    }
+}
+
+static inline void timerNodeInit(timer_node_t *node) {
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+static inline bool timerArmed(const timer_node_t *node) {
+    return node->next != NULL;
+}
+
+/*
+    Función que pone el nodo en la ranura que le toca según qué tan lejos está su vencimiento.
+    Lo que vence más allá del último nivel se queda en la última ranura y se vuelve a repartir
+*/
+static inline void timerWheelLink(timer_wheel_t *wheel, timer_node_t *node) {
+    uint64_t expires = node->expires;
+    uint64_t delta = expires - wheel->now;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+    uint64_t span = (uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (delta >= span) {
+        expires = wheel->now + span - 1;
+    }
+    timer_node_t *head = &wheel->slots[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+/*
+    Función que agrega un temporizador que vence en el tick expires. Lo que ya venció sale en el
+    siguiente tick
+*/
+static inline void timerWheelAdd(timer_wheel_t *wheel, timer_node_t *node, uint64_t expires) {
+    node->expires = expires > wheel->now ? expires : wheel->now + 1;
+    timerWheelLink(wheel, node);
+    wheel->count++;
+}
+
+/*
+    Función que cancela un temporizador. No hace nada si no estaba en la rueda
+*/
+static inline void timerWheelCancel(timer_wheel_t *wheel, timer_node_t *node) {
+    if (!timerArmed(node)) {
+        return;
+    }
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    timerNodeInit(node);
+    wheel->count--;
+}
+
+/*
+    Función que avanza la rueda hasta el tick now y regresa los temporizadores vencidos en una lista
+    ligada por prev; next queda en NULL para que timerArmed los vea fuera de la rueda. Quien llama
+    los puede volver a agregar o liberar
+*/
+static inline timer_node_t *timerWheelAdvance(timer_wheel_t *wheel, uint64_t now) {
+    timer_node_t *expired = NULL;
+    while (wheel->now < now && wheel->count > 0) {
+        wheel->now++;
+        // Al completar una vuelta de un nivel se reparte la ranura que sigue del nivel de arriba
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (((wheel->now >> (TIMER_WHEEL_BITS * (level - 1))) & TIMER_WHEEL_MASK) != 0) {
+                break;
+            }
+            timer_node_t *head = &wheel->slots[level][(wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+            timer_node_t *node = head->next;
+            head->next = head;
+            head->prev = head;
+            while (node != head) {
+                timer_node_t *next = node->next;
+                timerWheelLink(wheel, node);
+                node = next;
+            }
+        }
+
+        timer_node_t *head = &wheel->slots[0][wheel->now & TIMER_WHEEL_MASK];
+        while (head->next != head) {
+            timer_node_t *node = head->next;
+            timerWheelCancel(wheel, node);
+            node->prev = expired;
+            expired = node;
+        }
+    }
+    // Sin temporizadores no hay nada que recorrer, el reloj de la rueda solo se alcanza
+    if (wheel->now < now) {
+        wheel->now = now;
+    }
+    return expired;
+}
+
+#endif
@@ -5,25 +5,12 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <time.h>
+#include "P2/protocol.h"
+#include "P2/resolver.h"
+#include "P2/clientLog.h"
 
 #define BUFFER_SIZE 1024
 
-/*
-    Función para guardar fecha, hora, estado, nombre de archivo y servidor
-*/
-void saveLog(const char *status, const char *filename, const char *server) {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", t);
-    
-    FILE *log_file = fopen("clientLog.txt", "a");
-    if (log_file) {
-        fprintf(log_file, "%s | %s | %s | %s\n", timestamp, status, filename, server);
-        fclose(log_file);
-    }
-}
-
 int main(int argc, char *argv[]) {
     if (argc != 4) {
         printf("USE: %s <SERVER> <PORT> <FILE>\n", argv[0]);
@@ -37,7 +24,6 @@ int main(int argc, char *argv[]) {
     char *filename = argv[3];
     struct sockaddr_in serv_addr;
     int dynamic_port;
-    struct addrinfo hints, *res;
     // Leer archivo
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -46,17 +32,9 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    char file_content[BUFFER_SIZE] = {0};
-    size_t bytes_read = fread(file_content, 1, sizeof(file_content) - 1, fp);
-    file_content[bytes_read] = '\0';
-    fclose(fp);
-
-    //Obtenemos la dirección ip atraves del alias
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    
-    if (getaddrinfo(server_ip, NULL, &hints, &res) != 0) {
+    //Obtenemos la dirección ip atraves del alias, normalmente desde la caché
+    struct in_addr server_addr;
+    if (resolveHost(server_ip, &server_addr) < 0) {
         perror("Error resolving hostname");
         saveLog("ERROR", filename, "Host resolution failed");
         exit(1);
@@ -72,10 +50,7 @@ int main(int argc, char *argv[]) {
     // Configuramos la dirección del cliente
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_port = htons(port);
-    struct sockaddr_in *ipv4 = (struct sockaddr_in *)res->ai_addr;
-    serv_addr.sin_addr = ipv4->sin_addr;
-    
-    freeaddrinfo(res);  
+    serv_addr.sin_addr = server_addr;
 
     //Nos conectamos al servidor
     if (connect(client_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
@@ -105,10 +80,8 @@ int main(int argc, char *argv[]) {
             exit(1);
         }
 
-        char buffer[BUFFER_SIZE*2];
-        snprintf(buffer, sizeof(buffer), "%s|%s|%s", server_ip, filename, file_content);
-
-        if (send(dynamic_sock, buffer, strlen(buffer), 0) < 0) {
+        // alias|archivo|contenido con el contenido directo del archivo, como lo espera el servidor
+        if (protocolSendFile(dynamic_sock, fp, false, server_ip, filename, 0, 0) < 0) {
             perror("Send failed");
             close(dynamic_sock);
             exit(1);
@@ -127,5 +100,6 @@ int main(int argc, char *argv[]) {
         close(dynamic_sock);
     }
     
+    fclose(fp);
     return 0;
 }
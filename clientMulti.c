@@ -3,6 +3,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include "P2/protocol.h"
 
 #define BUFFER_SIZE 1024
 
@@ -70,15 +71,11 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
-        char file_content[BUFFER_SIZE] = {0};
-        size_t bytes_read = fread(file_content, 1, sizeof(file_content) - 1, fp);
-        file_content[bytes_read] = '\0';
-        fclose(fp);
-
         //Creamos el socket del servidor para la comunicación
         client_sock = socket(AF_INET, SOCK_STREAM, 0);
         if (client_sock < 0) {
             perror("Socket creation failed");
+            fclose(fp);
             continue;
         }
         
@@ -91,14 +88,17 @@ int main(int argc, char *argv[]) {
         if (connect(client_sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
             perror("Connection failed");
             close(client_sock);
+            fclose(fp);
             continue;
         }
 
-        char buffer[BUFFER_SIZE];
-        snprintf(buffer, sizeof(buffer), "%d|%d|%s", ports[j], shift, file_content);
+        char header[BUFFER_SIZE];
+        snprintf(header, sizeof(header), "%d|%d|", ports[j], shift);
 
-        // Enviamos el contenido del archivo al servidor
-        if (send(client_sock, buffer, strlen(buffer), 0) < 0) {
+        // Enviamos el contenido del archivo al servidor, el mensaje completo cabe en un buffer del servidor
+        int sent = protocolSendHeaded(client_sock, header, strlen(header), fp, BUFFER_SIZE - 1 - strlen(header));
+        fclose(fp);
+        if (sent < 0) {
             perror("Send failed");
             close(client_sock);
             continue;